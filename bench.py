@@ -0,0 +1,182 @@
+#!/usr/bin/env python
+#
+# bench.py - Measures the throughput of ./csim. Every trace is simulated
+#     on a matrix of (s,E,b) configurations, once as given and once
+#     replayed several times over (each replay shifted to fresh
+#     addresses) from a binary copy. For every run it reports the
+#     accesses simulated per second, the peak resident set size and the
+#     wall time as CSV, and compares the throughput against a stored
+#     baseline so that regressions show up before they are deployed.
+#
+#     make bench            runs the suite and compares to the baseline
+#     make bench-baseline   runs the suite and stores it as the baseline
+#
+import subprocess;
+import os;
+import sys;
+import csv;
+import optparse;
+
+# Traces and the (s,E,b) configurations they are simulated with
+TRACES = ["traces/long.trace", "traces/sort4k.trace"]
+CONFIGS = [(1, 1, 1), (4, 2, 4), (5, 1, 5), (8, 4, 6), (10, 16, 6),
+           (12, 8, 6)]
+
+# Scaled replays are written here
+BENCH_DIR = ".bench"
+BASELINE = "bench-baseline.csv"
+FIELDS = ["trace", "s", "E", "b", "accesses", "wall_s", "accesses_per_s",
+          "peak_rss_kb"]
+
+#
+# countAccesses - number of accesses csim simulates for a text trace
+#
+def countAccesses(path):
+    count = 0
+    for line in open(path):
+        if line[:1] == " " and line[1:2] in "LSM":
+            count += 1
+    return count
+
+#
+# makeReplay - writes a text trace repeating path scale times, each copy
+#     shifted by 4GB, and converts it to a binary trace
+#
+def makeReplay(path, scale):
+    name = os.path.splitext(os.path.basename(path))[0]
+    text = os.path.join(BENCH_DIR, "%s-x%d.trace" % (name, scale))
+    binary = os.path.join(BENCH_DIR, "%s-x%d.bin" % (name, scale))
+    if os.path.exists(binary) and \
+       os.path.getmtime(binary) > os.path.getmtime(path):
+        return binary
+
+    lines = open(path).read().splitlines()
+    out = open(text, "w")
+    for i in range(scale):
+        for line in lines:
+            if line[:1] != " " or "," not in line:
+                continue
+            op, rest = line.split()
+            addr, size = rest.split(",")
+            out.write(" %s %x,%s\n" % (op, int(addr, 16) + (i << 32), size))
+    out.close()
+    subprocess.check_call(["./tracebin", text, binary])
+    os.remove(text)
+    return binary
+
+#
+# runCsim - runs csim once through ./benchrun and returns (wall time,
+#     peak RSS in KB)
+#
+def runCsim(path, s, E, b):
+    args = ["./benchrun", "./csim", "-s", str(s), "-E", str(E), "-b", str(b),
+            "-t", path]
+    p = subprocess.Popen(args, stdout=subprocess.PIPE)
+    stdout_data = p.communicate()[0]
+    if p.returncode != 0:
+        print("%s failed" % " ".join(args[1:]))
+        sys.exit(1)
+    wall, rss = stdout_data.decode("utf-8").split()
+    return float(wall), int(rss)
+
+#
+# loadBaseline - maps (trace, s, E, b) to the baseline accesses/s
+#
+def loadBaseline(path):
+    baseline = {}
+    if not os.path.exists(path):
+        return baseline
+    for row in csv.DictReader(open(path)):
+        key = (row["trace"], row["s"], row["E"], row["b"])
+        baseline[key] = float(row["accesses_per_s"])
+    return baseline
+
+#
+# main - Main function
+#
+def main():
+
+    # Parse the command line arguments
+    p = optparse.OptionParser()
+    p.add_option("-n", type="int", dest="repeat", default=5,
+                 help="runs per configuration, the fastest is kept");
+    p.add_option("-x", type="int", dest="scale", default=32,
+                 help="number of times the scaled replays repeat a trace");
+    p.add_option("-o", dest="output", default="bench.csv",
+                 help="CSV file to write the results to");
+    p.add_option("--baseline", dest="baseline", default=BASELINE,
+                 help="baseline CSV to compare against");
+    p.add_option("--save-baseline", action="store_true", dest="save",
+                 help="store the results as the new baseline");
+    p.add_option("--tolerance", type="float", dest="tolerance", default=0.10,
+                 help="slowdown, as a fraction, reported as a regression");
+    opts, args = p.parse_args()
+
+    if not os.path.isdir(BENCH_DIR):
+        os.mkdir(BENCH_DIR)
+
+    # Building the list of (label, path, accesses) workloads
+    workloads = []
+    for path in TRACES:
+        accesses = countAccesses(path)
+        name = os.path.basename(path)
+        workloads.append((name, path, accesses))
+        workloads.append(("%s-x%d" % (name, opts.scale),
+                          makeReplay(path, opts.scale),
+                          accesses * opts.scale))
+
+    # Running every configuration
+    rows = []
+    writer = csv.DictWriter(sys.stdout, FIELDS)
+    writer.writeheader()
+    for (label, path, accesses) in workloads:
+        for (s, E, b) in CONFIGS:
+            runs = [runCsim(path, s, E, b) for i in range(opts.repeat)]
+            wall = min(r[0] for r in runs)
+            row = {"trace": label, "s": s, "E": E, "b": b,
+                   "accesses": accesses, "wall_s": "%.4f" % wall,
+                   "accesses_per_s": "%.0f" % (accesses / wall),
+                   "peak_rss_kb": max(r[1] for r in runs)}
+            writer.writerow(row)
+            sys.stdout.flush()
+            rows.append(row)
+
+    out = csv.DictWriter(open(opts.output, "w"), FIELDS)
+    out.writeheader()
+    out.writerows(rows)
+
+    if opts.save:
+        out = csv.DictWriter(open(opts.baseline, "w"), FIELDS)
+        out.writeheader()
+        out.writerows(rows)
+        print("Saved baseline to %s" % opts.baseline)
+        return
+
+    # Comparing against the baseline
+    baseline = loadBaseline(opts.baseline)
+    if not baseline:
+        print("No baseline in %s, create one with make bench-baseline" %
+              opts.baseline)
+        return
+    regressions = 0
+    print("\nChange in accesses/s against %s:" % opts.baseline)
+    for row in rows:
+        key = (row["trace"], str(row["s"]), str(row["E"]), str(row["b"]))
+        if key not in baseline:
+            continue
+        change = float(row["accesses_per_s"]) / baseline[key] - 1
+        flag = ""
+        if change < -opts.tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-20s s=%-2d E=%-2d b=%-2d %+6.1f%%%s" %
+              (row["trace"], row["s"], row["E"], row["b"], change * 100,
+               flag))
+    if regressions:
+        print("%d configurations regressed by more than %.0f%%" %
+              (regressions, opts.tolerance * 100))
+        sys.exit(1)
+
+# execute main only if called as a script
+if __name__ == "__main__":
+    main()
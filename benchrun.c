@@ -0,0 +1,64 @@
+/*
+ * benchrun.c - Runs a command and prints its wall time in seconds and its
+ * peak resident set size in kilobytes, for bench.py.
+ *
+ *     linux> ./benchrun ./csim -s 5 -E 1 -b 5 -t traces/long.trace
+ *     0.0312 1480
+ *
+ * The kernel carries a process's peak RSS across exec, so a command
+ * started straight from Python reports at least the interpreter's
+ * footprint. Forking from this small process keeps the figure honest.
+ * The command's stdout is discarded.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE /* for wait4() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+int main(int argc, char* argv[])
+{
+   struct timespec start, end;
+   struct rusage usage;
+   int status;
+   pid_t pid;
+
+   if(argc < 2) {
+      fprintf(stderr, "Usage: %s <command> [args...]\n", argv[0]);
+      exit(1);
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   if((pid = fork()) == -1) {
+      perror("fork");
+      exit(1);
+   }
+   if(pid == 0) {
+      int devnull = open("/dev/null", O_WRONLY);
+      if(devnull != -1) {
+         dup2(devnull, STDOUT_FILENO);
+      }
+      execv(argv[1], &argv[1]);
+      perror(argv[1]);
+      _exit(127);
+   }
+   if(wait4(pid, &status, 0, &usage) == -1) {
+      perror("wait4");
+      exit(1);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   if(!WIFEXITED(status) || WEXITSTATUS(status)) {
+      fprintf(stderr, "%s failed\n", argv[1]);
+      exit(1);
+   }
+   // ru_maxrss is in kilobytes on Linux
+   printf("%.4f %ld\n", (end.tv_sec - start.tv_sec) +
+          (end.tv_nsec - start.tv_nsec) / 1e9, usage.ru_maxrss);
+   return 0;
+}
@@ -0,0 +1,566 @@
+/*
+ * cache.c - Single-level cache model used by csim (see cache.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+#include "lookup.h"
+#include "profile.h"
+
+/* Prints only when verbose is true*/
+static void verbose_print(cache_t* c, char* str);
+
+/* Performs the necessary actions for a data load */
+static void data_load(cache_t* c, int set_index, int line_index, uint64_t key,
+                      int miss);
+
+/* Performs the necessary actions for a data store of size bytes at addr */
+static void data_store(cache_t* c, int set_index, int line_index, uint64_t key,
+                       int miss, uint64_t addr, unsigned int size);
+
+/* Updates the counters for a cache eviction, writing dirty data back */
+static void cache_eviction(cache_t* c, int line);
+
+/* Updates the counters for a cache hit */
+static void cache_hit(cache_t* c, int line_index, int set_index);
+
+/*
+ * find_line - Looks up addr. Returns the line index (set-major, local to
+ * the cache) on a hit and -1 on a miss, with *set_index set either way.
+ */
+static int find_line(cache_t* c, uint64_t addr, int* set_index);
+
+/* Address of the first byte of the block held by a valid line */
+static uint64_t line_addr(cache_t* c, int set_index, int line);
+
+/* Sectors of the block holding addr covered by size bytes (0 = all) */
+static uint64_t sector_mask(cache_t* c, uint64_t addr, unsigned int size);
+
+/* Marks sectors of a line dirty, counting the bytes newly dirtied */
+static void set_dirty(cache_t* c, int line, uint64_t mask);
+
+/*
+ * clear_dirty - Cleans a line, storing its dirty sectors in mask (0 if it
+ * was clean). Returns the number of dirty bytes it held.
+ */
+static long clear_dirty(cache_t* c, int line, uint64_t* mask);
+
+/*
+ * mem_write - Writes sectors of the block holding addr to memory, through
+ * the write-combining buffer if there is one
+ */
+static void mem_write(cache_t* c, uint64_t addr, uint64_t mask);
+
+/* Records a use of a line with the replacement policy */
+static inline void touch_line(cache_t* c, int set_index, int line_index,
+                              int fill);
+
+
+
+int cache_init(cache_t* c, int set_bits, int assoc, int block_bits,
+               const repl_policy_t* policy) {
+   return cache_init_sets(c, set_bits, assoc, block_bits, policy,
+                          0, 1U << set_bits);
+}
+
+
+
+int cache_init_sets(cache_t* c, int set_bits, int assoc, int block_bits,
+                    const repl_policy_t* policy,
+                    unsigned int first_set, unsigned int num_sets) {
+   size_t lines = (size_t)num_sets * assoc;
+   unsigned int i;
+   memset(c, 0, sizeof(*c));
+   c->set_bits = set_bits;
+   c->assoc = assoc;
+   c->block_bits = block_bits;
+   c->first_set = first_set;
+   c->num_sets = num_sets;
+   c->policy = policy;
+   c->sector_bits = block_bits;
+   c->lookup = lookup_for(assoc);
+
+   // nothing is allocated after this point
+   c->tags = (uint64_t*)calloc(lines, sizeof(uint64_t));
+   c->dirty = (char*)calloc(lines, sizeof(char));
+   c->repl = (uint64_t*)calloc(lines, sizeof(uint64_t));
+   c->repl_set = (uint64_t*)calloc(num_sets, sizeof(uint64_t));
+   c->mru = (int*)calloc(num_sets, sizeof(int));
+   if(!(c->tags && c->dirty && c->repl && c->repl_set && c->mru)) {
+      cache_free(c);
+      return -1;
+   }
+   for(i=0; i<num_sets; ++i) {
+      policy->init(c, i);
+   }
+   return 0;
+}
+
+
+
+int cache_set_write_policy(cache_t* c, const cache_write_policy_t* policy) {
+   size_t lines = (size_t)c->num_sets * c->assoc;
+   int sector_bits = 0;
+
+   if(policy->sector_bytes) {
+      while((1L << sector_bits) < policy->sector_bytes) {
+         sector_bits++;
+      }
+   } else {
+      sector_bits = c->block_bits;
+   }
+   if((policy->sector_bytes && 1L << sector_bits != policy->sector_bytes) ||
+      sector_bits > c->block_bits || c->block_bits - sector_bits > 6) {
+      fprintf(stderr, "Sectors must be a power of two of at most the block "
+              "size, and at least 1/64 of it\n");
+      return -1;
+   }
+   if(policy->combine_depth < 0) {
+      fprintf(stderr, "Invalid write-combining buffer depth\n");
+      return -1;
+   }
+
+   c->write = *policy;
+   c->sector_bits = sector_bits;
+   c->sector_writes = policy->write_through || sector_bits < c->block_bits;
+   if(sector_bits < c->block_bits &&
+      !(c->dirty_mask = (uint64_t*)calloc(lines, sizeof(uint64_t)))) {
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+   if(policy->combine_depth) {
+      c->wc_addr = (uint64_t*)calloc(policy->combine_depth, sizeof(uint64_t));
+      c->wc_mask = (uint64_t*)calloc(policy->combine_depth, sizeof(uint64_t));
+      if(!c->wc_addr || !c->wc_mask) {
+         fprintf(stderr, "Failed to allocate memory");
+         return -1;
+      }
+   }
+   return 0;
+}
+
+
+
+void cache_access_size(cache_t* c, char op, uint64_t addr, unsigned int size,
+                       cache_result_t* res) {
+   int line_index;
+   int cold_index;
+   int miss;
+   int assoc = c->assoc;
+   int set_index = cache_set_index(c->set_bits, c->block_bits, addr)
+                   - c->first_set;
+   uint64_t key = (addr >> (c->set_bits + c->block_bits)) | LINE_VALID;
+   uint64_t start = 0;
+
+   if(op == 'I') {
+      return;
+   }
+   if(c->prof) {
+      start = prof_ticks();
+   }
+
+   // finding if there is a cache hit or miss
+   line_index = c->lookup(&c->tags[set_index*assoc], assoc, key, &cold_index);
+   if(c->prof) {
+      uint64_t now = prof_ticks();
+      c->prof->lookup += now - start;
+      start = now;
+   }
+
+   // a store miss that does not allocate goes straight to memory
+   if(line_index == -1 && op == 'S' && c->write.no_allocate) {
+      c->stats.misses++;
+      verbose_print(c, "miss ");
+      mem_write(c, addr, sector_mask(c, addr, size));
+      if(res) {
+         memset(res, 0, sizeof(*res));
+      }
+      if(c->prof) {
+         c->prof->update += prof_ticks() - start;
+      }
+      return;
+   }
+
+   // finding the appropriate line to write to
+   if(line_index == -1 && cold_index != -1) { // cold miss
+      line_index = cold_index;
+      miss = 2;
+   } else if(line_index == -1) { // miss, the policy picks the victim
+      line_index = c->policy->victim(c, set_index);
+      miss = 1;
+   } else { // hit
+      miss = 0;
+   }
+
+   if(res) {
+      int line = set_index*assoc+line_index;
+      res->hit = !miss;
+      res->evicted = miss == 1;
+      res->victim_dirty = miss == 1 && c->dirty[line];
+      res->victim_addr = miss == 1 ? line_addr(c, set_index, line) : 0;
+   }
+
+   // performing appropriate actions based on the action
+   switch(op) {
+      case 'L':
+      data_load(c, set_index, line_index, key, miss);
+      break;
+
+      case 'S':
+      data_store(c, set_index, line_index, key, miss, addr, size);
+      break;
+
+      case 'M':
+      data_load(c, set_index, line_index, key, miss);
+      data_store(c, set_index, line_index, key, 0, addr, size);
+      break;
+   }
+   if(c->prof) {
+      c->prof->update += prof_ticks() - start;
+   }
+}
+
+
+
+void cache_insert(cache_t* c, uint64_t addr, int dirty, cache_result_t* res) {
+   int set_index;
+   int line_index;
+   int cold_index;
+   int line = find_line(c, addr, &set_index);
+   uint64_t key = (addr >> (c->set_bits + c->block_bits)) | LINE_VALID;
+
+   if(res) {
+      memset(res, 0, sizeof(*res));
+   }
+   if(line != -1) {
+      if(res) {
+         res->hit = 1;
+      }
+   } else {
+      line_index = c->lookup(&c->tags[set_index*c->assoc], c->assoc, key,
+                              &cold_index);
+      if(cold_index == -1) {
+         line_index = c->policy->victim(c, set_index);
+         line = set_index*c->assoc+line_index;
+         if(res) {
+            res->evicted = 1;
+            res->victim_dirty = c->dirty[line];
+            res->victim_addr = line_addr(c, set_index, line);
+         }
+         cache_eviction(c, line);
+      } else {
+         line_index = cold_index;
+         line = set_index*c->assoc+line_index;
+      }
+      c->tags[line] = key;
+      touch_line(c, set_index, line_index, 1);
+   }
+
+   if(dirty) {
+      set_dirty(c, line, sector_mask(c, addr, 0));
+   }
+}
+
+
+
+int cache_invalidate(cache_t* c, uint64_t addr) {
+   int set_index;
+   int line = find_line(c, addr, &set_index);
+   uint64_t mask;
+
+   if(line == -1) {
+      return -1;
+   }
+   clear_dirty(c, line, &mask);
+   c->tags[line] = 0;
+   return mask != 0;
+}
+
+
+
+int cache_clean(cache_t* c, uint64_t addr) {
+   int set_index;
+   int line = find_line(c, addr, &set_index);
+   uint64_t mask;
+
+   if(line == -1 || !c->dirty[line]) {
+      return 0;
+   }
+   clear_dirty(c, line, &mask);
+   mem_write(c, addr, mask);
+   return 1;
+}
+
+
+
+int cache_contains(cache_t* c, uint64_t addr) {
+   int set_index;
+   return find_line(c, addr, &set_index) != -1;
+}
+
+
+
+void cache_mark_dirty(cache_t* c, uint64_t addr) {
+   int set_index;
+   int line = find_line(c, addr, &set_index);
+   if(line != -1) {
+      set_dirty(c, line, sector_mask(c, addr, 0));
+   }
+}
+
+
+
+void cache_free(cache_t* c) {
+   free(c->tags);
+   free(c->dirty);
+   free(c->repl);
+   free(c->repl_set);
+   free(c->mru);
+   free(c->dirty_mask);
+   free(c->wc_addr);
+   free(c->wc_mask);
+   c->dirty_mask = NULL;
+   c->wc_addr = NULL;
+   c->wc_mask = NULL;
+   c->tags = NULL;
+   c->dirty = NULL;
+   c->repl = NULL;
+   c->repl_set = NULL;
+   c->mru = NULL;
+}
+
+
+
+void cache_write_stats(const cache_t* c, cache_write_stats_t* stats) {
+   int i;
+   *stats = c->mem_write;
+   for(i=0; i<c->wc_used; ++i) {
+      int entry = (c->wc_head + i) % c->write.combine_depth;
+      stats->bytes += (long)__builtin_popcountll(c->wc_mask[entry])
+                      << c->sector_bits;
+      stats->writes++;
+   }
+}
+
+
+
+void cache_stats_add(cache_stats_t* dst, const cache_stats_t* src) {
+   dst->hits += src->hits;
+   dst->misses += src->misses;
+   dst->evictions += src->evictions;
+   dst->dirty_evicted += src->dirty_evicted;
+   dst->dirty_active += src->dirty_active;
+   dst->double_accesses += src->double_accesses;
+}
+
+
+
+static void verbose_print(cache_t* c, char* str) {
+   if(c->verbose) {
+      printf("%s", str);
+   }
+}
+
+
+
+static void data_load(cache_t* c, int set_index, int line_index, uint64_t key,
+                      int miss) {
+   int line = set_index*c->assoc+line_index;
+
+   // checking hits
+   if(!miss){
+      cache_hit(c, line_index, set_index);
+   } else {
+      c->stats.misses++;
+      verbose_print(c, "miss ");
+
+      c->tags[line]=key;
+      if(miss != 2) { // line is valid but tag isn't (conflict miss)
+         cache_eviction(c, line);
+      }
+   }
+   touch_line(c, set_index, line_index, miss != 0);
+}
+
+
+
+static void data_store(cache_t* c, int set_index, int line_index, uint64_t key,
+                       int miss, uint64_t addr, unsigned int size) {
+   int line = set_index*c->assoc+line_index; // index in the array
+
+   // checking hits
+   if(!miss){
+      cache_hit(c, line_index, set_index);
+   } else {
+      c->stats.misses++;
+      verbose_print(c, "dirty miss ");
+
+      c->tags[line]=key;
+      if(miss != 2) { // line is valid but tag isn't (conflict miss)
+         cache_eviction(c, line);
+      }
+   }
+   touch_line(c, set_index, line_index, miss != 0);
+
+   // a write-back store dirties the line, a write-through one goes on
+   if(!c->sector_writes) {
+      if(!c->dirty[line]) {
+         c->dirty[line] = 1;
+         c->stats.dirty_active += 1 << c->block_bits;
+      }
+   } else if(c->write.write_through) {
+      mem_write(c, addr, sector_mask(c, addr, size));
+   } else {
+      set_dirty(c, line, sector_mask(c, addr, size));
+   }
+}
+
+
+
+static void cache_eviction(cache_t* c, int line) {
+   if(c->dirty[line] && (c->dirty_mask || c->write.combine_depth)) {
+      uint64_t mask;
+      verbose_print(c, "dirty-eviction ");
+      c->stats.dirty_evicted += clear_dirty(c, line, &mask);
+      mem_write(c, line_addr(c, line / c->assoc, line), mask);
+   } else if(c->dirty[line]) { // the whole block straight to memory
+      verbose_print(c, "dirty-eviction ");
+      c->stats.dirty_active -= 1 << c->block_bits;
+      c->stats.dirty_evicted += 1 << c->block_bits;
+      c->dirty[line] = 0;
+      c->mem_write.bytes += 1 << c->block_bits;
+      c->mem_write.writes++;
+   } else {
+      verbose_print(c, "eviction ");
+   }
+
+   c->stats.evictions++;
+}
+
+
+
+static void cache_hit(cache_t* c, int line_index, int set_index) {
+   c->stats.hits++;
+   if(line_index == c->mru[set_index]) {
+      c->stats.double_accesses++;
+      verbose_print(c, "hit-double_ref ");
+   } else {
+      verbose_print(c, "hit ");
+   }
+}
+
+
+
+static inline void touch_line(cache_t* c, int set_index, int line_index,
+                              int fill) {
+   c->policy->touch(c, set_index, line_index, fill);
+   c->mru[set_index] = line_index;
+}
+
+
+
+static int find_line(cache_t* c, uint64_t addr, int* set_index) {
+   int cold;
+   int way;
+   uint64_t key = (addr >> (c->set_bits + c->block_bits)) | LINE_VALID;
+   *set_index = cache_set_index(c->set_bits, c->block_bits, addr)
+                - c->first_set;
+   way = c->lookup(&c->tags[*set_index*c->assoc], c->assoc, key, &cold);
+   return way == -1 ? -1 : *set_index*c->assoc+way;
+}
+
+
+
+static uint64_t line_addr(cache_t* c, int set_index, int line) {
+   return ((c->tags[line] & ~LINE_VALID) << (c->set_bits + c->block_bits)) |
+          ((uint64_t)(c->first_set + set_index) << c->block_bits);
+}
+
+
+
+static uint64_t sector_mask(cache_t* c, uint64_t addr, unsigned int size) {
+   int sectors = 1 << (c->block_bits - c->sector_bits);
+   uint64_t offset = addr & ((1UL << c->block_bits) - 1);
+   uint64_t last = offset + size - 1;
+   int first_sector, count;
+
+   if(!size) {
+      return sectors == 64 ? ~0ULL : (1ULL << sectors) - 1;
+   }
+   if(last >> c->block_bits) { // the rest lies in the next block
+      last = (1UL << c->block_bits) - 1;
+   }
+   first_sector = offset >> c->sector_bits;
+   count = (last >> c->sector_bits) - first_sector + 1;
+   return (count == 64 ? ~0ULL : (1ULL << count) - 1) << first_sector;
+}
+
+
+
+static void set_dirty(cache_t* c, int line, uint64_t mask) {
+   if(c->dirty_mask) {
+      uint64_t added = mask & ~c->dirty_mask[line];
+      c->dirty_mask[line] |= mask;
+      c->stats.dirty_active += (long)__builtin_popcountll(added)
+                               << c->sector_bits;
+      c->dirty[line] = 1;
+   } else if(!c->dirty[line]) {
+      c->dirty[line] = 1;
+      c->stats.dirty_active += 1 << c->block_bits;
+   }
+}
+
+
+
+static long clear_dirty(cache_t* c, int line, uint64_t* mask) {
+   long bytes;
+   if(!c->dirty[line]) {
+      *mask = 0;
+      return 0;
+   }
+   *mask = c->dirty_mask ? c->dirty_mask[line] : 1;
+   bytes = (long)__builtin_popcountll(*mask) << c->sector_bits;
+   c->stats.dirty_active -= bytes;
+   c->dirty[line] = 0;
+   if(c->dirty_mask) {
+      c->dirty_mask[line] = 0;
+   }
+   return bytes;
+}
+
+
+
+static void mem_write(cache_t* c, uint64_t addr, uint64_t mask) {
+   cache_write_stats_t* w = &c->mem_write;
+   int depth = c->write.combine_depth;
+   uint64_t block = addr >> c->block_bits;
+   int i, entry;
+
+   if(!depth) {
+      w->bytes += (long)__builtin_popcountll(mask) << c->sector_bits;
+      w->writes++;
+      return;
+   }
+
+   // merging into a buffered write to the same block
+   for(i=0; i<c->wc_used; ++i) {
+      entry = (c->wc_head + i) % depth;
+      if(c->wc_addr[entry] == block) {
+         c->wc_mask[entry] |= mask;
+         w->merged++;
+         return;
+      }
+   }
+   if(c->wc_used == depth) { // draining the oldest entry to memory
+      w->bytes += (long)__builtin_popcountll(c->wc_mask[c->wc_head])
+                  << c->sector_bits;
+      w->writes++;
+      c->wc_head = (c->wc_head + 1) % depth;
+      c->wc_used--;
+   }
+   entry = (c->wc_head + c->wc_used) % depth;
+   c->wc_addr[entry] = block;
+   c->wc_mask[entry] = mask;
+   c->wc_used++;
+}
@@ -0,0 +1,170 @@
+/*
+ * cache.h - Single-level set-associative cache model with a pluggable
+ * replacement policy (LRU by default, see policy.h), write-allocate and
+ * write-back, as simulated by csim.
+ *
+ * Write-through, write-no-allocate, a write-combining buffer in front of
+ * memory and dirty bits per sector rather than per block can be chosen
+ * with cache_set_write_policy(). Dirty byte counts are then whole dirty
+ * sectors, and every write to memory (write-backs, write-throughs and
+ * store misses that do not allocate) is counted in mem_write.
+ *
+ * A cache_t may cover only a contiguous range of the sets of the full
+ * cache (see cache_init_sets()). Sets never interact, so several such
+ * partial caches fed with the accesses to their own sets produce the same
+ * counts as one full cache.
+ */
+#ifndef CSIM_CACHE_H
+#define CSIM_CACHE_H
+
+#include <stdint.h>
+#include "policy.h"
+#include "lookup.h"
+#include "libcsim.h"
+
+/* The counters reported by printSummary(), as exposed by libcsim */
+typedef csim_stats_t cache_stats_t;
+
+/* Write handling and memory write traffic, as exposed by libcsim */
+typedef csim_write_policy_t cache_write_policy_t;
+typedef csim_write_stats_t cache_write_stats_t;
+
+/* Ticks spent in the phases of cache_access(), see profile.h */
+typedef struct cache_prof {
+   uint64_t lookup;
+   uint64_t update;
+} cache_prof_t;
+
+typedef struct cache {
+   // geometry
+   int set_bits;
+   int assoc;
+   int block_bits;
+   unsigned int first_set;  /* first set index covered by this cache */
+   unsigned int num_sets;   /* number of sets covered */
+   int verbose;             /* print the outcome of every access */
+
+   // per line state, set-major: tags hold tag|LINE_VALID (0 if invalid)
+   uint64_t* tags;
+   char* dirty;
+   lookup_fn lookup;        /* tag search, lookup_for(assoc) */
+
+   /*
+    * Replacement state: one word per line parallel to tags and one word
+    * per set, interpreted by the policy. use_clock is a per-cache counter
+    * the policies may use for timestamps. mru[set] holds the way touched
+    * last, which is what a double reference hits, whatever the policy.
+    */
+   const repl_policy_t* policy;
+   uint64_t* repl;
+   uint64_t* repl_set;
+   int* mru;
+   unsigned long use_clock;
+
+   // write handling, see cache_set_write_policy()
+   cache_write_policy_t write;
+   int sector_bits;         /* log2 of the sector size */
+   int sector_writes;       /* stores write through or dirty sectors */
+   uint64_t* dirty_mask;    /* dirty sectors per line, NULL for whole blocks */
+   uint64_t* wc_addr;       /* write-combining buffer, FIFO of blocks */
+   uint64_t* wc_mask;       /* sectors written to each buffered block */
+   int wc_used;
+   int wc_head;             /* oldest entry */
+   cache_write_stats_t mem_write;
+
+   cache_stats_t stats;
+   cache_prof_t* prof;      /* phase timers, NULL unless profiling */
+} cache_t;
+
+/* What happened on one access, for caches chained behind this one */
+typedef struct cache_result {
+   int hit;               /* the access (the load part of 'M') hit */
+   int evicted;           /* a valid line was evicted to make room */
+   int victim_dirty;      /* the evicted line was dirty */
+   uint64_t victim_addr;  /* address of the first byte of the evicted block */
+} cache_result_t;
+
+/*
+ * cache_init - Allocates an empty cache of 2^s sets of E lines of 2^b
+ * bytes replaced according to policy. Returns 0 on success and -1 if
+ * memory could not be allocated.
+ */
+int cache_init(cache_t* c, int set_bits, int assoc, int block_bits,
+               const repl_policy_t* policy);
+
+/*
+ * cache_init_sets - Like cache_init(), but only allocates the num_sets sets
+ * starting at first_set. Accesses to other sets must not be passed in.
+ */
+int cache_init_sets(cache_t* c, int set_bits, int assoc, int block_bits,
+                    const repl_policy_t* policy,
+                    unsigned int first_set, unsigned int num_sets);
+
+/*
+ * cache_set_write_policy - Chooses how stores reach memory, before any
+ * access. Returns 0 on success, and -1 with a message on stderr if the
+ * sector size does not fit the block or memory could not be allocated.
+ */
+int cache_set_write_policy(cache_t* c, const cache_write_policy_t* policy);
+
+/*
+ * cache_access_size - Simulates one access of size bytes; op is 'L', 'S'
+ * or 'M' ('I' is ignored). A store dirties the sectors it covers, or the
+ * whole block when size is 0. If res is not NULL it receives the outcome.
+ */
+void cache_access_size(cache_t* c, char op, uint64_t addr, unsigned int size,
+                       cache_result_t* res);
+
+/* Simulates one access that dirties the whole block, see above */
+static inline void cache_access(cache_t* c, char op, uint64_t addr,
+                                cache_result_t* res) {
+   cache_access_size(c, op, addr, 0, res);
+}
+
+/*
+ * cache_insert - Places a block in the cache without counting a hit or a
+ * miss, as when a victim of a higher level is written into an exclusive
+ * lower level. The block is marked dirty if dirty is set. Evictions are
+ * counted and reported through res as for cache_access().
+ */
+void cache_insert(cache_t* c, uint64_t addr, int dirty, cache_result_t* res);
+
+/*
+ * cache_invalidate - Removes the block holding addr, if present, without
+ * counting an eviction. Returns -1 if the block was not cached, and
+ * otherwise whether it was dirty.
+ */
+int cache_invalidate(cache_t* c, uint64_t addr);
+
+/*
+ * cache_clean - Writes the block holding addr back to memory if it is
+ * cached and dirty, leaving it cached and clean. Returns whether it was
+ * dirty.
+ */
+int cache_clean(cache_t* c, uint64_t addr);
+
+/* Returns whether the block holding addr is cached, changing nothing */
+int cache_contains(cache_t* c, uint64_t addr);
+
+/* Marks the block holding addr dirty if it is cached */
+void cache_mark_dirty(cache_t* c, uint64_t addr);
+
+/* Frees the memory held by the cache */
+void cache_free(cache_t* c);
+
+/*
+ * cache_write_stats - Stores the memory write traffic so far, counting
+ * the blocks still in the write-combining buffer as written
+ */
+void cache_write_stats(const cache_t* c, cache_write_stats_t* stats);
+
+/* Adds the counters in src to dst */
+void cache_stats_add(cache_stats_t* dst, const cache_stats_t* src);
+
+/* Set index of an address */
+static inline unsigned int cache_set_index(int set_bits, int block_bits,
+                                           uint64_t addr) {
+   return (addr >> block_bits) & ((1UL << set_bits)-1);
+}
+
+#endif /* CSIM_CACHE_H */
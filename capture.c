@@ -0,0 +1,127 @@
+/*
+ * capture.c - ThreadSanitizer hooks feeding captured accesses to a
+ * simulator (see capture.h)
+ */
+#include <stdint.h>
+#include "capture.h"
+
+typedef struct capture_region {
+   uintptr_t start;
+   uintptr_t end;
+   uint64_t base;
+} capture_region_t;
+
+typedef struct capture {
+   csim_t* sim;                 /* NULL when not capturing */
+   int num_regions;
+   capture_region_t regions[CAPTURE_MAX_REGIONS];
+   long count;
+} capture_t;
+
+static __thread capture_t cap;
+
+/*
+ * Simulates an access of size bytes if it falls in a region of an active
+ * capture. An access wider than 8 bytes, such as a vector load, is
+ * simulated once per block it covers.
+ */
+static inline void capture_access(char op, const void* addr,
+                                  unsigned long size) {
+   uintptr_t a = (uintptr_t)addr;
+   int i;
+   if(!cap.sim) {
+      return;
+   }
+   for(i=0; i<cap.num_regions; ++i) {
+      const capture_region_t* r = &cap.regions[i];
+      if(a >= r->start && a < r->end) {
+         uint64_t sim_addr = r->base + (a - r->start);
+         uint64_t end = sim_addr + size;
+         csim_access(cap.sim, op, sim_addr);
+         cap.count++;
+         if(size > 8) {
+            uint64_t block = 1UL << csim_block_bits(cap.sim);
+            for(sim_addr = (sim_addr | (block - 1)) + 1; sim_addr < end;
+                sim_addr += block) {
+               csim_access(cap.sim, op, sim_addr);
+            }
+         }
+         return;
+      }
+   }
+}
+
+
+
+void capture_start(csim_t* sim) {
+   csim_access(sim, 'S', CAPTURE_MARKER_START);
+   cap.sim = sim;
+   cap.num_regions = 0;
+   cap.count = 0;
+}
+
+
+
+int capture_region(const void* start, size_t len, uint64_t base) {
+   capture_region_t* r;
+   if(cap.num_regions == CAPTURE_MAX_REGIONS) {
+      return -1;
+   }
+   r = &cap.regions[cap.num_regions++];
+   r->start = (uintptr_t)start;
+   r->end = (uintptr_t)start + len;
+   r->base = base;
+   return 0;
+}
+
+
+
+void capture_stop(void) {
+   if(cap.sim) {
+      csim_access(cap.sim, 'S', CAPTURE_MARKER_END);
+   }
+   cap.sim = NULL;
+   cap.num_regions = 0;
+}
+
+
+
+long capture_count(void) {
+   return cap.count;
+}
+
+
+
+/*
+ * The hooks gcc -fsanitize=thread emits calls to. Function entry and exit
+ * and the runtime initialisation have nothing to do; every load is an 'L'
+ * and every store an 'S', like lackey reports them (a read-modify-write
+ * is a load then a store of the same block, which counts as lackey's 'M').
+ */
+void __tsan_init(void) {}
+void __tsan_func_entry(void* pc) {}
+void __tsan_func_exit(void) {}
+
+#define CAPTURE_HOOKS(size) \
+   void __tsan_read##size(void* addr) { capture_access('L', addr, size); } \
+   void __tsan_write##size(void* addr) { capture_access('S', addr, size); } \
+   void __tsan_unaligned_read##size(void* addr) { \
+      capture_access('L', addr, size); \
+   } \
+   void __tsan_unaligned_write##size(void* addr) { \
+      capture_access('S', addr, size); \
+   }
+
+CAPTURE_HOOKS(1)
+CAPTURE_HOOKS(2)
+CAPTURE_HOOKS(4)
+CAPTURE_HOOKS(8)
+CAPTURE_HOOKS(16)
+
+void __tsan_read_range(void* addr, unsigned long size) {
+   capture_access('L', addr, size);
+}
+
+void __tsan_write_range(void* addr, unsigned long size) {
+   capture_access('S', addr, size);
+}
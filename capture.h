@@ -0,0 +1,76 @@
+/*
+ * capture.h - Native capture of the memory accesses of transpose
+ * functions, without valgrind.
+ *
+ * trans.c is compiled a second time with -fsanitize=thread into
+ * trans-cap.o. That makes gcc call __tsan_read4(addr), __tsan_write4(addr)
+ * and friends before every load and store the functions perform.
+ * capture.c defines those hooks in place of the ThreadSanitizer runtime.
+ * While a capture is active on the calling thread, every access that
+ * falls in a registered region is moved to the region's base address and
+ * simulated on the spot. Stack and other accesses are ignored, so no
+ * address filters are needed.
+ *
+ *     capture_start(sim);
+ *     capture_region(A, sizeof(A), CAPTURE_A_BASE);
+ *     capture_region(B, sizeof(B), CAPTURE_B_BASE);
+ *     trans(M, N, A, B);
+ *     capture_stop();
+ *
+ * Capture state is per thread, so several captures can run concurrently.
+ */
+#ifndef CSIM_CAPTURE_H
+#define CSIM_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "libcsim.h"
+
+#define CAPTURE_MAX_REGIONS 4
+
+/*
+ * Addresses matching the layout of tracegen's static int A[256][256] and
+ * B[256][256]: A starts 0x140 bytes into a page and B directly follows
+ * it. Every set of a cache up to a page per way therefore sees the same
+ * blocks as in a valgrind trace of tracegen. Larger matrices are mapped
+ * by tracegen the same way, B right after A's elems ints, which
+ * CAPTURE_B_BASE_FOR() follows.
+ */
+#define CAPTURE_A_BASE 0x10000140UL
+#define CAPTURE_B_BASE (CAPTURE_A_BASE + 256*256*sizeof(int))
+#define CAPTURE_B_BASE_FOR(elems) \
+   ((elems) > 256*256 ? CAPTURE_A_BASE + (elems)*sizeof(int) : CAPTURE_B_BASE)
+
+/*
+ * tracegen's start and end markers, which it keeps 0x20 bytes before A.
+ * capture_start() and capture_stop() simulate the stores to them, so the
+ * end marker store misses when the function evicted the marker, as in a
+ * -V trace. The start marker store is a compulsory miss, and
+ * CAPTURE_FIXED_MISSES should be taken off the count, like test-trans
+ * takes 3 off a -V trace, which also loads func_list, M and N.
+ */
+#define CAPTURE_MARKER_START (CAPTURE_A_BASE - 0x20)
+#define CAPTURE_MARKER_END (CAPTURE_MARKER_START + 1)
+#define CAPTURE_FIXED_MISSES 1
+
+/*
+ * capture_start - Simulates the store to the start marker on sim, then
+ * starts capturing the calling thread's accesses into it
+ */
+void capture_start(csim_t* sim);
+
+/*
+ * capture_region - Captures accesses to [start, start+len) of the active
+ * capture, reported as if the region started at base. Returns 0 on
+ * success and -1 if there are already CAPTURE_MAX_REGIONS regions.
+ */
+int capture_region(const void* start, size_t len, uint64_t base);
+
+/* Stops capturing, simulates the store to the end marker and forgets the
+ * regions */
+void capture_stop(void);
+
+/* Number of accesses captured since capture_start() */
+long capture_count(void);
+
+#endif /* CSIM_CAPTURE_H */
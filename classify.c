@@ -0,0 +1,238 @@
+/*
+ * classify.c - Compulsory/capacity/conflict miss classification (see
+ * classify.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "classify.h"
+#include "lookup.h"
+
+/* Initial size of the first-touch table, a power of two */
+#define SEEN_INIT_SIZE 4096
+
+/* Hash of a key, before masking to the table size */
+static inline size_t hash_key(uint64_t key) {
+   return (size_t)((key * 0x9E3779B97F4A7C15UL) >> 20);
+}
+
+/* Adds key to the first-touch set. Returns 1 if it was not there yet */
+static int seen_insert(classify_t* cl, uint64_t key);
+
+/*
+ * shadow_access - Accesses key in the shadow fully-associative cache.
+ * Returns 1 on a hit, and 0 on a miss after filling the block.
+ */
+static int shadow_access(classify_t* cl, uint64_t key);
+
+/* Returns the slot holding line's index, line's key must be present */
+static size_t slot_find(classify_t* cl, uint64_t key);
+
+/* Empties a slot, shifting back the entries probing past it */
+static void slot_delete(classify_t* cl, size_t slot);
+
+/* Removes a line from the recency list */
+static void list_unlink(classify_t* cl, int line);
+
+/* Inserts a line at the MRU end of the recency list */
+static void list_push(classify_t* cl, int line);
+
+
+
+int classify_init(classify_t* cl, int lines, int block_bits) {
+   size_t slots = 1;
+   memset(cl, 0, sizeof(*cl));
+   cl->block_bits = block_bits;
+   cl->lines = lines;
+   cl->head = cl->tail = -1;
+
+   // at most half full, so probe sequences stay short
+   while(slots < 2 * (size_t)lines) {
+      slots <<= 1;
+   }
+   cl->slot_mask = slots - 1;
+   cl->seen_mask = SEEN_INIT_SIZE - 1;
+
+   cl->seen = (uint64_t*)calloc(SEEN_INIT_SIZE, sizeof(uint64_t));
+   cl->keys = (uint64_t*)calloc(lines, sizeof(uint64_t));
+   cl->prev = (int*)calloc(lines, sizeof(int));
+   cl->next = (int*)calloc(lines, sizeof(int));
+   cl->slots = (int*)malloc(slots * sizeof(int));
+   if(!(cl->seen && cl->keys && cl->prev && cl->next && cl->slots)) {
+      classify_free(cl);
+      return -1;
+   }
+   memset(cl->slots, -1, slots * sizeof(int));
+   return 0;
+}
+
+
+
+void classify_access(classify_t* cl, uint64_t addr, int hit) {
+   uint64_t key = (addr >> cl->block_bits) | LINE_VALID;
+   int first = seen_insert(cl, key);
+   int shadow_hit = shadow_access(cl, key);
+
+   if(hit) {
+      return;
+   }
+   if(first) {
+      cl->compulsory++;
+   } else if(!shadow_hit) {
+      cl->capacity++;
+   } else {
+      cl->conflict++;
+   }
+}
+
+
+
+void classify_free(classify_t* cl) {
+   free(cl->seen);
+   free(cl->keys);
+   free(cl->prev);
+   free(cl->next);
+   free(cl->slots);
+   cl->seen = cl->keys = NULL;
+   cl->prev = cl->next = cl->slots = NULL;
+}
+
+
+
+static int seen_insert(classify_t* cl, uint64_t key) {
+   size_t i = hash_key(key) & cl->seen_mask;
+
+   while(cl->seen[i]) {
+      if(cl->seen[i] == key) {
+         return 0;
+      }
+      i = (i+1) & cl->seen_mask;
+   }
+   cl->seen[i] = key;
+
+   // doubling once half full
+   if(++cl->seen_count * 2 > cl->seen_mask) {
+      size_t old_size = cl->seen_mask + 1;
+      uint64_t* old = cl->seen;
+      uint64_t* grown = (uint64_t*)calloc(old_size * 2, sizeof(uint64_t));
+      size_t j;
+      if(!grown) {
+         return 1; // keep probing the full table, just slower
+      }
+      cl->seen = grown;
+      cl->seen_mask = old_size * 2 - 1;
+      for(j=0; j<old_size; ++j) {
+         if(old[j]) {
+            i = hash_key(old[j]) & cl->seen_mask;
+            while(grown[i]) {
+               i = (i+1) & cl->seen_mask;
+            }
+            grown[i] = old[j];
+         }
+      }
+      free(old);
+   }
+   return 1;
+}
+
+
+
+static int shadow_access(classify_t* cl, uint64_t key) {
+   size_t i = hash_key(key) & cl->slot_mask;
+   int line;
+
+   while(cl->slots[i] != -1) {
+      line = cl->slots[i];
+      if(cl->keys[line] == key) { // hit
+         if(line != cl->head) {
+            list_unlink(cl, line);
+            list_push(cl, line);
+         }
+         return 1;
+      }
+      i = (i+1) & cl->slot_mask;
+   }
+
+   // miss, filling a free line or the LRU one
+   if(cl->used < cl->lines) {
+      line = cl->used++;
+   } else {
+      line = cl->tail;
+      slot_delete(cl, slot_find(cl, cl->keys[line]));
+      list_unlink(cl, line);
+      // the deletion may have shifted an entry into the probe sequence
+      i = hash_key(key) & cl->slot_mask;
+      while(cl->slots[i] != -1) {
+         i = (i+1) & cl->slot_mask;
+      }
+   }
+   cl->keys[line] = key;
+   cl->slots[i] = line;
+   list_push(cl, line);
+   return 0;
+}
+
+
+
+static size_t slot_find(classify_t* cl, uint64_t key) {
+   size_t i = hash_key(key) & cl->slot_mask;
+   while(cl->keys[cl->slots[i]] != key) {
+      i = (i+1) & cl->slot_mask;
+   }
+   return i;
+}
+
+
+
+static void slot_delete(classify_t* cl, size_t slot) {
+   size_t i = slot;
+   size_t j = slot;
+
+   // backward shift deletion for linear probing, no tombstones needed
+   for(;;) {
+      size_t home;
+      cl->slots[i] = -1;
+      for(;;) {
+         j = (j+1) & cl->slot_mask;
+         if(cl->slots[j] == -1) {
+            return;
+         }
+         home = hash_key(cl->keys[cl->slots[j]]) & cl->slot_mask;
+         // the entry at j can move to i unless its home lies in (i, j]
+         if(i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            break;
+         }
+      }
+      cl->slots[i] = cl->slots[j];
+      i = j;
+   }
+}
+
+
+
+static void list_unlink(classify_t* cl, int line) {
+   int p = cl->prev[line];
+   int n = cl->next[line];
+   if(p != -1) {
+      cl->next[p] = n;
+   } else {
+      cl->head = n;
+   }
+   if(n != -1) {
+      cl->prev[n] = p;
+   } else {
+      cl->tail = p;
+   }
+}
+
+
+
+static void list_push(classify_t* cl, int line) {
+   cl->prev[line] = -1;
+   cl->next[line] = cl->head;
+   if(cl->head != -1) {
+      cl->prev[cl->head] = line;
+   } else {
+      cl->tail = line;
+   }
+   cl->head = line;
+}
@@ -0,0 +1,62 @@
+/*
+ * classify.h - Splits the misses of a cache into the three Cs.
+ *
+ *   compulsory  the block had never been accessed before
+ *   capacity    a fully-associative LRU cache of the same number of lines
+ *               would also have missed
+ *   conflict    the fully-associative cache would have hit, so the miss
+ *               is due to the mapping of blocks to sets
+ *
+ * The shadow fully-associative cache is a doubly linked recency list over
+ * a fixed pool of lines, indexed by an open-addressing hash table, so an
+ * access costs O(1) whatever the capacity. The first-touch set is a
+ * second hash table that grows as new blocks appear.
+ */
+#ifndef CSIM_CLASSIFY_H
+#define CSIM_CLASSIFY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct classify {
+   int block_bits;
+
+   // blocks ever accessed, block|LINE_VALID, 0 = empty slot
+   uint64_t* seen;
+   size_t seen_mask;
+   size_t seen_count;
+
+   // shadow fully-associative LRU cache, lines linked MRU first
+   uint64_t* keys;   /* block|LINE_VALID of each line */
+   int* prev;
+   int* next;
+   int head;         /* MRU line, -1 when empty */
+   int tail;         /* LRU line */
+   int used;         /* lines in use */
+   int lines;        /* capacity */
+   int* slots;       /* hash table of line indexes, -1 = empty slot */
+   size_t slot_mask;
+
+   long compulsory;
+   long capacity;
+   long conflict;
+} classify_t;
+
+/*
+ * classify_init - Prepares to classify the misses of a cache of lines
+ * lines of 2^block_bits bytes. Returns 0 on success and -1 if memory
+ * could not be allocated.
+ */
+int classify_init(classify_t* cl, int lines, int block_bits);
+
+/*
+ * classify_access - Records an access to addr (the load of an 'M' counts,
+ * its store cannot miss) and, if the real cache missed (hit = 0),
+ * classifies the miss. Call for every access, in trace order.
+ */
+void classify_access(classify_t* cl, uint64_t addr, int hit);
+
+/* Frees the shadow cache and the first-touch set */
+void classify_free(classify_t* cl);
+
+#endif /* CSIM_CLASSIFY_H */
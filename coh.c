@@ -0,0 +1,385 @@
+/*
+ * coh.c - MESI and MOESI coherence between private caches (see coh.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coh.h"
+
+/* Slot of a block in the table */
+static inline size_t line_slot(const coh_t* h, uint64_t block);
+
+/*
+ * find_line - Returns the state of block, adding it if add is set.
+ * Returns NULL if the block is unknown (or, when adding, if memory could
+ * not be allocated).
+ */
+static coh_line_t* find_line(coh_t* h, uint64_t block, int add);
+
+/* Doubles the table */
+static int grow(coh_t* h);
+
+/* Slices of a block covered by size bytes at addr, all of them if 0 */
+static uint64_t slice_mask(const coh_t* h, uint64_t addr, unsigned int size);
+
+/* Invalidates every copy of the block but core's, before a write */
+static void invalidate_others(coh_t* h, coh_line_t* line, int core,
+                              uint64_t addr);
+
+/* Fetches the block for a miss of core, as a BusRd or a BusRdX */
+static void miss(coh_t* h, coh_line_t* line, int core, int write,
+                 uint64_t addr, uint64_t mask);
+
+/* Next number of a xorshift generator */
+static unsigned int next_random(unsigned int* state);
+
+
+
+int coh_init(coh_t* h, coh_protocol_t protocol, int num_cores, int set_bits,
+             int assoc, int block_bits, const repl_policy_t* policy) {
+   int i;
+
+   memset(h, 0, sizeof(*h));
+   h->protocol = protocol;
+   h->block_bits = block_bits;
+   h->slice_bits = block_bits > 6 ? block_bits - 6 : 0;
+   h->capacity = 1024;
+   h->lines = (coh_line_t*)calloc(h->capacity, sizeof(coh_line_t));
+   h->written = (uint64_t*)calloc(h->capacity * num_cores, sizeof(uint64_t));
+   if(!h->lines || !h->written) {
+      coh_free(h);
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+   for(i=0; i<num_cores; ++i) {
+      if(cache_init(&h->cores[i], set_bits, assoc, block_bits, policy)) {
+         coh_free(h);
+         fprintf(stderr, "Failed to allocate memory");
+         return -1;
+      }
+      h->num_cores++;
+   }
+   return 0;
+}
+
+
+
+void coh_access(coh_t* h, int core, char op, uint64_t addr,
+                unsigned int size) {
+   uint64_t block = addr >> h->block_bits;
+   uint64_t mask = slice_mask(h, addr, size);
+   int write = op == 'S' || op == 'M';
+   int bit = 1 << core;
+   coh_line_t* line;
+   cache_result_t r;
+   int k;
+
+   if(op == 'I') {
+      return;
+   }
+   if(!(line = find_line(h, block, 1))) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+
+   if(!(line->sharers & bit)) {
+      miss(h, line, core, write, addr, mask);
+   } else if(write && line->owner == core && line->state == 'E') {
+      line->state = 'M';
+   } else if(write && !(line->owner == core && line->state == 'M')) {
+      h->stats[core].upgrades++;
+      invalidate_others(h, line, core, addr);
+      line->owner = core;
+      line->state = 'M';
+   }
+   if(write) {
+      for(k=0; k<h->num_cores; ++k) {
+         if(line->lost & (1 << k)) {
+            h->written[(line - h->lines) * h->num_cores + k] |= mask;
+         }
+      }
+   }
+
+   cache_access_size(&h->cores[core], op, addr, size, &r);
+   if(r.evicted) {
+      coh_line_t* victim = find_line(h, r.victim_addr >> h->block_bits, 0);
+      victim->sharers &= ~bit;
+      if(victim->owner == core) {
+         victim->owner = -1;
+      }
+      h->mem_writes += r.victim_dirty;
+   }
+}
+
+
+
+int coh_run(coh_t* h, trace_t** traces, int num_traces, const coh_cfg_t* cfg) {
+   long quantum = cfg->quantum ? cfg->quantum : 1;
+   unsigned int rng = cfg->seed;
+   int live = num_traces;
+   int done[COH_MAX_CORES] = {0};
+   int core = 0;
+   trace_rec_t rec;
+   long n;
+
+   if(num_traces == 1) { // a tagged trace, in its own order
+      while(trace_next(traces[0], &rec)) {
+         if(rec.thread >= h->num_cores) {
+            fprintf(stderr, "Access by thread %d, but only %d cores\n",
+                    rec.thread, h->num_cores);
+            return -1;
+         }
+         coh_access(h, rec.thread, rec.op, rec.addr, rec.size);
+      }
+      return 0;
+   }
+
+   while(live) {
+      if(rng) {
+         core = next_random(&rng) % num_traces;
+      }
+      while(done[core]) {
+         core = (core + 1) % num_traces;
+      }
+      for(n=0; n<quantum; ++n) {
+         if(!trace_next(traces[core], &rec)) {
+            done[core] = 1;
+            live--;
+            break;
+         }
+         coh_access(h, core, rec.op, rec.addr, rec.size);
+      }
+      if(!rng) {
+         core = (core + 1) % num_traces;
+      }
+   }
+   return 0;
+}
+
+
+
+int coh_hot_lines(const coh_t* h, const coh_line_t** hot, int n) {
+   int found = 0;
+   size_t i;
+   int j;
+
+   // insertion into the sorted top n
+   for(i=0; i<h->capacity; ++i) {
+      const coh_line_t* line = &h->lines[i];
+      if(!line->block || !line->invalidations) {
+         continue;
+      }
+      for(j=found < n ? found++ : n; j>0; --j) {
+         const coh_line_t* prev = hot[j - 1];
+         if(prev->false_sharing > line->false_sharing ||
+            (prev->false_sharing == line->false_sharing &&
+             prev->invalidations >= line->invalidations)) {
+            break;
+         }
+         if(j < n) {
+            hot[j] = prev;
+         }
+      }
+      if(j < n) {
+         hot[j] = line;
+      }
+   }
+   return found;
+}
+
+
+
+void coh_free(coh_t* h) {
+   int i;
+   for(i=0; i<h->num_cores; ++i) {
+      cache_free(&h->cores[i]);
+   }
+   free(h->lines);
+   free(h->written);
+   h->lines = NULL;
+   h->written = NULL;
+   h->num_cores = 0;
+}
+
+
+
+int coh_parse_protocol(const char* name, coh_protocol_t* protocol) {
+   if(!strcmp(name, "mesi")) {
+      *protocol = COH_MESI;
+   } else if(!strcmp(name, "moesi")) {
+      *protocol = COH_MOESI;
+   } else {
+      return -1;
+   }
+   return 0;
+}
+
+
+
+static inline size_t line_slot(const coh_t* h, uint64_t block) {
+   return (block * 0x9e3779b97f4a7c15ULL >> 32) & (h->capacity - 1);
+}
+
+
+
+static coh_line_t* find_line(coh_t* h, uint64_t block, int add) {
+   size_t slot = line_slot(h, block);
+   coh_line_t* line;
+
+   while(h->lines[slot].block && h->lines[slot].block != block + 1) {
+      slot = (slot + 1) & (h->capacity - 1);
+   }
+   line = &h->lines[slot];
+   if(line->block || !add) {
+      return line->block ? line : NULL;
+   }
+   if(2 * (h->used + 1) > h->capacity) {
+      if(grow(h)) {
+         return NULL;
+      }
+      return find_line(h, block, add);
+   }
+   h->used++;
+   line->block = block + 1;
+   line->owner = -1;
+   return line;
+}
+
+
+
+static int grow(coh_t* h) {
+   coh_t old = *h;
+   size_t i;
+   int k;
+
+   h->capacity *= 2;
+   h->lines = (coh_line_t*)calloc(h->capacity, sizeof(coh_line_t));
+   h->written = (uint64_t*)calloc(h->capacity * h->num_cores,
+                                  sizeof(uint64_t));
+   if(!h->lines || !h->written) {
+      free(h->lines);
+      free(h->written);
+      h->lines = old.lines;
+      h->written = old.written;
+      h->capacity = old.capacity;
+      return -1;
+   }
+
+   for(i=0; i<old.capacity; ++i) {
+      size_t slot;
+      if(!old.lines[i].block) {
+         continue;
+      }
+      slot = line_slot(h, old.lines[i].block - 1);
+      while(h->lines[slot].block) {
+         slot = (slot + 1) & (h->capacity - 1);
+      }
+      h->lines[slot] = old.lines[i];
+      for(k=0; k<h->num_cores; ++k) {
+         h->written[slot * h->num_cores + k] =
+            old.written[i * h->num_cores + k];
+      }
+   }
+   free(old.lines);
+   free(old.written);
+   return 0;
+}
+
+
+
+static uint64_t slice_mask(const coh_t* h, uint64_t addr, unsigned int size) {
+   int slices = 1 << (h->block_bits - h->slice_bits);
+   uint64_t offset = addr & ((1UL << h->block_bits) - 1);
+   uint64_t last = offset + size - 1;
+   int first, count;
+
+   if(!size) {
+      return slices == 64 ? ~0ULL : (1ULL << slices) - 1;
+   }
+   if(last >> h->block_bits) { // the rest lies in the next block
+      last = (1UL << h->block_bits) - 1;
+   }
+   first = offset >> h->slice_bits;
+   count = (last >> h->slice_bits) - first + 1;
+   return (count == 64 ? ~0ULL : (1ULL << count) - 1) << first;
+}
+
+
+
+static void invalidate_others(coh_t* h, coh_line_t* line, int core,
+                              uint64_t addr) {
+   int k;
+   for(k=0; k<h->num_cores; ++k) {
+      if(k == core || !(line->sharers & (1 << k))) {
+         continue;
+      }
+      // a dirty copy hands its data to the writer, which now owns it
+      cache_invalidate(&h->cores[k], addr);
+      line->lost |= 1 << k;
+      h->written[(line - h->lines) * h->num_cores + k] = 0;
+      h->stats[k].invalidations++;
+      line->invalidations++;
+   }
+   line->sharers &= 1 << core;
+}
+
+
+
+static void miss(coh_t* h, coh_line_t* line, int core, int write,
+                 uint64_t addr, uint64_t mask) {
+   int bit = 1 << core;
+   int owner = line->owner;
+   int dirty = owner != -1 && line->state != 'E';
+
+   if(line->lost & bit) {
+      uint64_t* written = &h->written[(line - h->lines) * h->num_cores + core];
+      h->stats[core].coherence_misses++;
+      if(*written & mask) {
+         line->true_sharing++;
+      } else {
+         h->stats[core].false_sharing++;
+         line->false_sharing++;
+      }
+      line->lost &= ~bit;
+      *written = 0;
+   }
+
+   // the owner supplies a dirty block, memory everything else
+   if(dirty) {
+      h->stats[core].transfers++;
+   } else {
+      h->mem_reads++;
+   }
+
+   if(write) { // BusRdX
+      invalidate_others(h, line, core, addr);
+      line->sharers = bit;
+      line->owner = core;
+      line->state = 'M';
+      return;
+   }
+
+   // BusRd
+   if(!line->sharers) {
+      line->owner = core;
+      line->state = 'E';
+   } else if(owner != -1 && line->state == 'M' && h->protocol == COH_MOESI) {
+      line->state = 'O';
+   } else if(owner != -1 && line->state == 'M') {
+      h->mem_writes += cache_clean(&h->cores[owner], addr);
+      line->owner = -1;
+   } else if(owner != -1 && line->state == 'E') {
+      line->owner = -1;
+   }
+   line->sharers |= bit;
+}
+
+
+
+static unsigned int next_random(unsigned int* state) {
+   unsigned int x = *state;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return *state = x;
+}
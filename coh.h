@@ -0,0 +1,126 @@
+/*
+ * coh.h - Multi-core simulation with private caches kept coherent by the
+ * MESI or MOESI protocol (csim -c).
+ *
+ * Every core has a private cache_t of the same geometry and replacement
+ * policy. The snooping bus between them is modelled by a table holding,
+ * for every block ever cached, the cores with a copy and the one owning
+ * it, which is what the caches would learn by snooping. A copy is in one
+ * of these states:
+ *
+ *   M  the only copy, dirty        E  the only copy, clean
+ *   O  dirty, other copies are S   S  shared, clean
+ *   (MOESI only)
+ *
+ * A read miss is a BusRd: with no other copy the block comes from memory
+ * in E. An M copy supplies the block; under MESI it is also written back
+ * and both copies become S, under MOESI it becomes O and stays dirty. A
+ * write to an E copy silently makes it M; a write to an S or O copy is a
+ * BusUpgr and a write miss a BusRdX, both invalidating every other copy.
+ *
+ * Counters, per core:
+ *
+ *   invalidations     copies of the core removed by another core's write
+ *   coherence_misses  misses to blocks the core last lost to an
+ *                     invalidation rather than to an eviction
+ *   false_sharing     coherence misses to bytes no other core wrote since
+ *                     the invalidation (tracked in 64 slices per block)
+ *   transfers         blocks supplied by another cache instead of memory
+ *   upgrades          BusUpgr transactions
+ *
+ * The per-core traces are interleaved in turns of quantum accesses, in
+ * round-robin order or, with a seed, in a pseudo-random order that only
+ * depends on the seed, so every run of the same configuration gives the
+ * same counts. A single thread-tagged trace (see trace.h) is simulated in
+ * its own order.
+ */
+#ifndef CSIM_COH_H
+#define CSIM_COH_H
+
+#include <stdint.h>
+#include "cache.h"
+#include "trace.h"
+
+#define COH_MAX_CORES 16
+
+typedef enum { COH_MESI, COH_MOESI } coh_protocol_t;
+
+typedef struct coh_cfg {
+   coh_protocol_t protocol;
+   int cores;             /* cores of a tagged trace, 0 = 4 */
+   long quantum;          /* accesses per turn, 0 = 1 */
+   unsigned int seed;     /* 0 = round-robin turns */
+} coh_cfg_t;
+
+typedef struct coh_stats {
+   long invalidations;
+   long coherence_misses;
+   long false_sharing;
+   long transfers;
+   long upgrades;
+} coh_stats_t;
+
+/* Coherence state of one block */
+typedef struct coh_line {
+   uint64_t block;        /* block number + 1, 0 = free slot */
+   uint16_t sharers;      /* cores holding a copy */
+   uint16_t lost;         /* cores whose copy was last invalidated */
+   signed char owner;     /* core in M, E or O, -1 if none */
+   char state;            /* 'M', 'E' or 'O', the state of the owner */
+   long invalidations;    /* copies invalidated */
+   long false_sharing;    /* coherence misses, as counted per core */
+   long true_sharing;
+} coh_line_t;
+
+typedef struct coh {
+   coh_protocol_t protocol;
+   int num_cores;
+   int block_bits;
+   int slice_bits;        /* log2 of the bytes per bit of written */
+   cache_t cores[COH_MAX_CORES];
+   coh_stats_t stats[COH_MAX_CORES];
+
+   // block table, open addressing on the block number
+   coh_line_t* lines;
+   uint64_t* written;     /* per line and core, the slices other cores
+                             wrote since the core's copy was invalidated */
+   size_t capacity;       /* power of 2 */
+   size_t used;
+
+   long mem_reads;        /* blocks read from memory */
+   long mem_writes;       /* dirty blocks written to memory */
+} coh_t;
+
+/*
+ * coh_init - Builds num_cores empty private caches of 2^s sets of E lines
+ * of 2^b bytes. Returns 0 on success, and -1 with a message on stderr if
+ * memory could not be allocated.
+ */
+int coh_init(coh_t* h, coh_protocol_t protocol, int num_cores, int set_bits,
+             int assoc, int block_bits, const repl_policy_t* policy);
+
+/* Simulates one access of size bytes by core; op is 'L', 'S', 'M' or 'I' */
+void coh_access(coh_t* h, int core, char op, uint64_t addr,
+                unsigned int size);
+
+/*
+ * coh_run - Simulates num_traces traces, one per core, interleaved as cfg
+ * says, or a single thread-tagged trace. Returns 0 on success, and -1
+ * with a message on stderr if a thread has no core.
+ */
+int coh_run(coh_t* h, trace_t** traces, int num_traces, const coh_cfg_t* cfg);
+
+/*
+ * coh_hot_lines - Stores the n blocks with the most false sharing misses,
+ * then the most invalidations, in hot. Returns how many were stored, as
+ * only blocks with an invalidation count.
+ */
+int coh_hot_lines(const coh_t* h, const coh_line_t** hot, int n);
+
+/* Frees the caches and the block table */
+void coh_free(coh_t* h);
+
+/* Parses "mesi" or "moesi". Returns -1 if unknown */
+int coh_parse_protocol(const char* name, coh_protocol_t* protocol);
+
+#endif /* CSIM_COH_H */
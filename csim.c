@@ -1,179 +1,283 @@
+#define _XOPEN_SOURCE 700 // for getsubopt
 #include "cachelab.h"
 #include <getopt.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include "libcsim.h"
+#include "trace.h"
+#include "lookup.h"
+#include "stackdist.h"
+#include "cache.h"
+#include "parsim.h"
+#include "hier.h"
+#include "classify.h"
+#include "sweep.h"
+#include "sample.h"
+#include "profile.h"
+#include "coh.h"
+#include "tlb.h"
+#include "timing.h"
+#include <string.h>
 
 // Parameters
 int verbose = 0;
 int set_bits = 0;
 int assoc = 1;
+int max_assoc = 0;   // > assoc when -E gives a range, see run_assoc_range()
 int block_bits = 0;
-FILE* trace_file;
-
-// Results
-int hits = 0;
-int misses = 0;
-int evictions = 0;
-int dirty_evicted = 0;
-int dirty_active = 0;
-int double_accesses = 0;
+trace_t trace;
+int trace_opened = 0;
+trace_t more_traces[COH_MAX_CORES - 1]; // further -t traces, one per core
+int num_traces = 0;
+const char* marker_file = NULL; // -m, "-" takes the markers from the trace
+int num_threads = 1; // > 1 runs parsim_run()
+const repl_policy_t* policy = REPL_LRU;
+int classify_misses = 0; // -C, split misses into the three Cs
+int profile = 0; // -P, see run_profiled()
+int write_given = 0; // -w, prints the memory write traffic
+csim_write_policy_t write_policy;
+int prefetch_given = 0; // -p, prints the prefetch counters
+csim_prefetch_t prefetch;
+int tlb_given = 0; // -T, translates every access next to the cache
+tlb_cfg_t tlb_cfg;
+
+// Lists given to -s/-E/-b/-r, more than one configuration runs run_sweep()
+int set_list[SWEEP_MAX_VALUES], num_set = 0;
+int assoc_list[SWEEP_MAX_VALUES], num_assoc = 0;
+int block_list[SWEEP_MAX_VALUES], num_block = 0;
+const repl_policy_t* policy_list[SWEEP_MAX_VALUES];
+int num_policy = 0;
+int sweep = 0;
+sweep_format_t sweep_format = SWEEP_CSV;
+
+// -S, estimates the counters from a sample, see run_sampled()
+int sampled = 0;
+sample_cfg_t sample_cfg;
+
+// -c, private caches kept coherent, see run_coherent()
+int coherent = 0;
+coh_cfg_t coh_cfg;
+int hot_lines = 5;
+
+// Levels below L1, given with -L, see run_hierarchy()
+int num_levels = 1;
+cache_geom_t levels[HIER_MAX_LEVELS];
+hier_inclusion_t inclusion = HIER_NINE;
+int timing_given = 0; // -D, estimates the run time of the hierarchy
+timing_cfg_t timing_cfg;
 
 /**************** Helper Functions ********************************/
 
-/* Queue Node */
-typedef struct Node {
-   struct Node *next, *prev;
-   int val;
-} Node;
+/*
+* get_opt_args - This function reads and sets the input arguments of the
+* simulator.
+*/
+void get_opt_args(int argc, char* argv[]);
 
-/* Queue struct */
-typedef struct Queue {
-   Node* head, *tail;
-   // int size;
-} Queue;
+/*
+* run_assoc_range - Simulates every associativity from assoc to max_assoc in
+* one pass over the trace and prints a summary row for each.
+*/
+void run_assoc_range(void);
 
-/* Queue Methods */
-void initialize_queue(Queue* q, int max_size);
-Node* enqueue(Queue* q, int val);
-int dequeue(Queue* q);
-int peek_head(Queue* q);
-int peek_tail(Queue* q);
-void move_front(Queue* q, Node* n);
+/*
+* run_hierarchy - Simulates the cache given by -s/-E/-b/-r as L1 in front of
+* the levels given by -L and prints a summary row per level, then the
+* timing estimate if -D was given.
+*/
+void run_hierarchy(void);
 
-void print_list(Queue* q);
+/*
+* run_sweep - Simulates every combination of the -s/-E/-b/-r lists on the
+* trace decoded once, and prints one CSV or JSON row per configuration.
+*/
+void run_sweep(void);
 
 /*
-* get_opt_args - This function reads and sets the input arguments of the
-* simulator.
+* run_sampled - Estimates the counters from the set or interval sample
+* given by -S and prints them with their 95% confidence intervals.
 */
-void get_opt_args(int argc, char* argv[]);
+void run_sampled(void);
+
+/*
+* run_profiled - Simulates the trace with the phases timed and the host's
+* hardware counters running, and prints the profile to stderr after the
+* summary.
+*/
+void run_profiled(void);
+
+/*
+* run_coherent - Simulates one private cache per -t trace, or per thread of
+* a tagged trace, kept coherent with the protocol given by -c, and prints
+* a summary row per core, the coherence totals and the hottest lines.
+*/
+void run_coherent(void);
 
-/* Prints only when verbose is true*/
-void verbose_print(char* str);
+/*
+* Parses a -c description
+* "mesi|moesi[,cores=<n>][,quantum=<n>][,seed=<x>][,hot=<n>]"
+*/
+void parse_coherence(char* desc, coh_cfg_t* cfg);
 
-/* Performs the necessary actions for a data load */
-void data_load(int set_index, int line_index, long tag, int miss, long* tags,
-            char* valid, char* dirty, Queue* usage_queue, Node** usage_table);
+/* Parses a -w description "wb|wt,alloc|noalloc,wc=<n>,sector=<bytes>" */
+void parse_write(char* desc, csim_write_policy_t* policy);
 
-/* Performs the necessary actions for a data store */
-void data_store(int set_index, int line_index, long tag, int miss, long* tags,
-            char* valid, char* dirty, Queue* usage_queue, Node** usage_table);
+/*
+* Parses a -p description
+* "next|stride|stream[,degree=<n>][,distance=<n>][,latency=<n>]"
+*/
+void parse_prefetch(char* desc, csim_prefetch_t* cfg);
 
-/* Updates global variables for a cache eviction */
-void cache_eviction(int line, char* dirty);
+/*
+* Parses a -T description
+* "[l1=<entries>[:<ways>],l2=...,l3=...][,page=4k|2m|1g][,pwc=<entries>]"
+*/
+void parse_tlb(char* desc, tlb_cfg_t* cfg);
 
-/* Updates global variables for a cache hit */
-void cache_hit(int line_index, int set_index, Queue* usage_queue);
+/*
+* Parses a -D description
+* "lat=<L1>[:<L2>...],mem=<cycles>,bw=<bytes/cycle>,mlp=<n>,ghz=<f>"
+*/
+void parse_timing(char* desc, timing_cfg_t* cfg);
+
+/* Parses a -S description, see run_sampled() */
+void parse_sample(char* desc, sample_cfg_t* cfg);
+
+/* Parses the list given to -s, -E or -b, exiting on errors */
+int parse_list(char opt, const char* arg, int* vals);
+
+/* Parses a -L level description "s=<s>,E=<E>,b=<b>[,r=<policy>]" */
+void parse_level(char* desc, cache_geom_t* geom);
+
+/* Prints the printSummary() counters on one line after a label */
+void print_stats_row(const char* label, const cache_stats_t* stats,
+                     const char* extra);
 
 
 /*************************** Code ********************************/
 
 int main(int argc, char* argv[])
 {
-   int i;
    get_opt_args(argc, argv);
+   lookup_init(NULL);
 
-   // masks to access certain parts of address
-   unsigned long block_mask = (1 << block_bits)-1;
-   unsigned long set_mask = ((1 << set_bits)-1) << block_bits;
-
-   // allocating memory for cache
-   long* tags = (long*)malloc((1 << set_bits)*assoc*sizeof(long));
-   char* valid = (char*)malloc((1 << set_bits)*assoc*sizeof(char));
-   char* dirty = (char*)malloc((1 << set_bits)*assoc*sizeof(char));
-
-   // for tracking usage
-   Queue* usage_queue = (Queue*)malloc((1 << set_bits)*sizeof(Queue));
-   // Hash table for quick access
-   Node** usage_table = (Node**)malloc((1 << set_bits)*assoc*sizeof(Node*));
-
-   // checking malloc pointers
-   if(!(tags && valid && dirty && usage_queue && usage_table)) {
-      fprintf(stderr, "Failed to allocate memory");
-      exit(1);
+   if(sweep) {
+      run_sweep();
+      return 0;
+   }
+   if(max_assoc > assoc) {
+      run_assoc_range();
+      return 0;
+   }
+   if(num_levels > 1 || timing_given) {
+      run_hierarchy();
+      return 0;
+   }
+   if(coherent) {
+      run_coherent();
+      return 0;
+   }
+   if(sampled) {
+      run_sampled();
+      return 0;
+   }
+   if(profile) {
+      run_profiled();
+      return 0;
    }
 
-   // reading trace file
-   char type;
-   unsigned long tr_addr;
-   int num_bytes;
-   while(fscanf(trace_file, " %c %lx,%i", &type, &tr_addr, &num_bytes) == 3) {
-      int line_index;
-      int cold_index;
-      int miss;
-      if(verbose) {
-         printf("%c %lx,%i ", type, tr_addr, num_bytes);
+   cache_stats_t stats;
+   csim_write_stats_t write_stats;
+   csim_prefetch_stats_t prefetch_stats;
+   classify_t cl;
+   tlb_t tlb;
+   if(num_threads > 1) {
+      if(parsim_run(&trace, set_bits, assoc, block_bits, policy,
+                    num_threads, &stats)) {
+         fprintf(stderr, "Failed to start worker threads\n");
+         exit(1);
+      }
+   } else {
+      csim_t* sim;
+      trace_rec_t rec;
+      int hit;
+      if(!(sim = csim_create(set_bits, assoc, block_bits, policy->name)) ||
+         csim_set_write_policy(sim, &write_policy) ||
+         (prefetch_given && csim_set_prefetcher(sim, &prefetch))) {
+         exit(1);
       }
-      unsigned int set_index = (tr_addr & set_mask) >> block_bits;
-      // int block_index = (tr_addr & block_mask);
-      unsigned long tag;
-      tag = (tr_addr & ~(set_mask | block_mask)) >> (set_bits+block_bits);
-
-      if(type != 'I') {
-         // finding if there is a cache hit or miss
-         line_index = -1;
-         cold_index = -1;
-         for(i=0; i<assoc; ++i) {
-            // cache hit (should only run once)
-            if(tag == tags[set_index*assoc+i] && valid[set_index*assoc+i]){
-               line_index=i;
+      if(classify_misses && ((long)assoc << set_bits) > INT_MAX) {
+         fprintf(stderr, "Too many lines to classify misses\n");
+         exit(1);
+      }
+      if(classify_misses &&
+         classify_init(&cl, assoc << set_bits, block_bits)) {
+         fprintf(stderr, "Failed to allocate memory");
+         exit(1);
+      }
+      if(tlb_given && tlb_init(&tlb, &tlb_cfg)) {
+         exit(1);
+      }
+      csim_set_verbose(sim, verbose);
+
+      // reading trace file (text or binary)
+      if(!verbose && !classify_misses && !tlb_given) {
+         csim_run_trace(sim, &trace);
+      } else {
+         while(trace_next(&trace, &rec)) {
+            if(verbose) {
+               printf("%c %lx,%u ", rec.op, (unsigned long)rec.addr,
+                      rec.size);
             }
-
-            // storing the first unfilled line
-            if(!valid[set_index*assoc+i] && cold_index == -1) {
-               cold_index = i;
+            hit = csim_access_size(sim, rec.op, rec.addr, rec.size);
+            if(classify_misses && rec.op != 'I') {
+               classify_access(&cl, rec.addr, hit);
+            }
+            if(tlb_given && rec.op != 'I') {
+               tlb_access(&tlb, rec.addr);
+            }
+            if(verbose) {
+               printf("\n");
             }
-         }
-
-         // finding the appropriate line to write to
-         if(line_index == -1 && cold_index != -1) { // cold miss
-            line_index = cold_index;
-            miss = 2;
-         } else if(line_index == -1) { // miss
-            line_index = peek_tail(&usage_queue[set_index]);
-            miss = 1;
-         } else { // hit
-            miss = 0;
-         }
-
-         // performing appropriate actions based on the action
-         switch(type) {
-            case 'L':
-            data_load(set_index, line_index, tag, miss, tags, valid,
-                      dirty, usage_queue, usage_table);
-            break;
-
-            case 'S':
-            data_store(set_index, line_index, tag, miss, tags, valid,
-                       dirty, usage_queue, usage_table);
-            break;
-
-            case 'M':
-            data_load(set_index, line_index, tag, miss, tags, valid,
-                      dirty, usage_queue, usage_table);
-            data_store(set_index, line_index, tag, 0, tags, valid,
-                       dirty, usage_queue, usage_table);
-            break;
          }
       }
-
-      verbose_print("\n");
+      csim_stats(sim, &stats);
+      csim_write_stats(sim, &write_stats);
+      csim_prefetch_stats(sim, &prefetch_stats);
+      csim_destroy(sim);
    }
 
-
-   printSummary(hits, misses, evictions, dirty_evicted,
-                dirty_active, double_accesses);
-
-   // freeing pointers
-   free(tags);
-   free(valid);
-   free(dirty);
-   free(usage_queue);
-   for(i=0; i<(1 << set_bits)*assoc; ++i) {
-      free(usage_table[i]);
+   printSummary(stats.hits, stats.misses, stats.evictions,
+                stats.dirty_evicted, stats.dirty_active, stats.double_accesses);
+   if(classify_misses) {
+      printf("compulsory:%ld capacity:%ld conflict:%ld\n", cl.compulsory,
+             cl.capacity, cl.conflict);
+      classify_free(&cl);
+   }
+   if(prefetch_given) {
+      printf("prefetch issued:%ld useful:%ld late:%ld polluting:%ld\n",
+             prefetch_stats.issued, prefetch_stats.useful,
+             prefetch_stats.late, prefetch_stats.polluting);
+   }
+   if(write_given) {
+      printf("memory write_bytes:%ld writes:%ld merged:%ld\n",
+             write_stats.bytes, write_stats.writes, write_stats.merged);
    }
-   free(usage_table);
+   if(tlb_given) {
+      int i;
+      for(i=0; i<tlb.num_levels; ++i) {
+         printf("tlb L%d hits:%ld misses:%ld\n", i+1,
+                tlb.levels[i].stats.hits, tlb.levels[i].stats.misses);
+      }
+      printf("tlb walks:%ld walk_refs:%ld pwc_hits:%ld\n", tlb.walks,
+             tlb.walk_refs, tlb.pwc_hits);
+      tlb_free(&tlb);
+   }
+
+   trace_close(&trace);
    return 0;
 }
 
@@ -182,34 +286,161 @@ int main(int argc, char* argv[])
 void get_opt_args(int argc, char* argv[]) {
    // Reading function arguments
    int opt;
-   while ((opt = getopt(argc, argv, "vs:b:E:t:")) != -1) {
+   while ((opt = getopt(argc, argv, "vCPs:b:E:t:m:j:r:o:w:p:c:T:D:L:I:S:")) != -1) {
       switch(opt) {
          case 'v':
          verbose = 1;
          break;
 
+         case 'C':
+         classify_misses = 1;
+         break;
+
+         case 'P':
+         profile = 1;
+         break;
+
          case 's':
-         set_bits = atoi(optarg);
+         num_set = parse_list('s', optarg, set_list);
+         set_bits = set_list[0];
          break;
 
          case 'b':
-         block_bits = atoi(optarg);
+         num_block = parse_list('b', optarg, block_list);
+         block_bits = block_list[0];
+         break;
+
+         case 'E': // E, a range Emin-Emax or a list for a sweep
+         num_assoc = parse_list('E', optarg, assoc_list);
+         assoc = assoc_list[0];
+         if(strchr(optarg, ',')) {
+            sweep = 1;
+         } else if(strchr(optarg, '-')) {
+            max_assoc = atoi(strchr(optarg, '-') + 1);
+         }
+         break;
+
+         case 'o':
+         if(!strcmp(optarg, "csv")) {
+            sweep_format = SWEEP_CSV;
+         } else if(!strcmp(optarg, "json")) {
+            sweep_format = SWEEP_JSON;
+         } else {
+            fprintf(stderr, "Unknown output format %s, choose from: csv "
+                    "json\n", optarg);
+            exit(1);
+         }
+         sweep = 1;
+         break;
+
+         case 'j':
+         num_threads = atoi(optarg);
+         break;
+
+         case 'r':
+         num_policy = sweep_parse_policies(optarg, policy_list,
+                                           SWEEP_MAX_VALUES);
+         if(num_policy < 1) {
+            const repl_policy_t* p;
+            fprintf(stderr, "Choose policies from:");
+            for(p=repl_policies; p->name; ++p) {
+               fprintf(stderr, " %s", p->name);
+            }
+            fprintf(stderr, "\n");
+            exit(1);
+         }
+         policy = policy_list[0];
+         break;
+
+         case 'L':
+         if(num_levels == HIER_MAX_LEVELS) {
+            fprintf(stderr, "At most %d levels are supported\n",
+                    HIER_MAX_LEVELS);
+            exit(1);
+         }
+         parse_level(optarg, &levels[num_levels++]);
+         break;
+
+         case 'I':
+         if(hier_parse_inclusion(optarg, &inclusion)) {
+            fprintf(stderr, "Unknown inclusion policy %s, choose from: nine "
+                    "inclusive exclusive\n", optarg);
+            exit(1);
+         }
+         break;
+
+         case 'w':
+         parse_write(optarg, &write_policy);
+         write_given = 1;
+         break;
+
+         case 'p':
+         parse_prefetch(optarg, &prefetch);
+         prefetch_given = 1;
+         break;
+
+         case 'D':
+         parse_timing(optarg, &timing_cfg);
+         timing_given = 1;
+         break;
+
+         case 'T':
+         parse_tlb(optarg, &tlb_cfg);
+         tlb_given = 1;
          break;
 
-         case 'E':
-         assoc = atoi(optarg);
+         case 'c':
+         parse_coherence(optarg, &coh_cfg);
+         coherent = 1;
+         break;
+
+         case 'S':
+         parse_sample(optarg, &sample_cfg);
+         sampled = 1;
          break;
 
          case 't':
-         if(!(trace_file = fopen(optarg, "r"))) {
-            fprintf(stderr, "Could not open file %s\n", optarg);
+         if(num_traces == COH_MAX_CORES) {
+            fprintf(stderr, "At most %d traces are supported\n",
+                    COH_MAX_CORES);
+            exit(1);
+         }
+         if(trace_open(num_traces ? &more_traces[num_traces - 1] : &trace,
+                       optarg)) {
             exit(1); // could not open file.
          }
+         trace_opened = 1;
+         num_traces++;
+         break;
+
+         case 'm':
+         marker_file = optarg;
          break;
 
          default:
-         fprintf(stderr, "Usage: %s [-v] -s <s> -E <E> -b <b> -t <tracefile>\n",
-                  argv[0]);
+         fprintf(stderr, "Usage: %s [-v] [-C] [-P] [-j <threads>] [-r <policy>] -s <s> "
+                 "-E <E>|<Emin>-<Emax> -b <b> -t <tracefile>|-\n"
+                 "       [-w wb|wt,alloc|noalloc,wc=<n>,sector=<bytes>] "
+                 "[-p next|stride|stream[,degree=<n>,distance=<n>,"
+                 "latency=<n>]]\n"
+                 "       [-T <tlb>, where <tlb> is one or more of "
+                 "l1=<entries>[:<ways>],l2=...,l3=...,\n"
+                 "       page=4k|2m|1g,pwc=<entries> (-T page=4k for the "
+                 "defaults)]\n"
+                 "       [-m <markerfile>|-] "
+                 "[-L s=<s>,E=<E>,b=<b>[,r=<policy>] ...] "
+                 "[-I nine|inclusive|exclusive]\n"
+                 "       [-D lat=<L1>[:<L2>...],mem=<cycles>,bw=<bytes/cycle>,"
+                 "mlp=<n>,ghz=<f>]\n"
+                 "       [-S sets=<n>[,seed=<x>]|"
+                 "period=<n>,window=<n>[,warmup=<n>]]\n"
+                 "Coherence: %s -c mesi|moesi[,cores=<n>,quantum=<n>,seed=<x>,"
+                 "hot=<n>] -s <s> -E <E> -b <b>\n"
+                 "       -t <tracefile> [-t <tracefile> ...]\n"
+                 "Sweep: %s [-j <threads>] [-o csv|json] -s <list> -E <list> "
+                 "-b <list> [-r <policy>,...] -t <tracefile>\n"
+                 "       where a list is like 4 or 1,2,4 or 1-8,16\n",
+                 argv[0], argv[0], argv[0]);
          exit(1);
       }
    }
@@ -217,188 +448,672 @@ void get_opt_args(int argc, char* argv[]) {
       fprintf(stderr, "Expected argument after options %i, %i\n", optind, argc);
       exit(1);
    }
-   if(!trace_file) {
+   if(!trace_opened) {
       fprintf(stderr, "No trace file provided\n");
       exit(1);
    }
+   if(marker_file && !strcmp(marker_file, "-")) {
+      trace_set_markers(&trace, 0, 0, 1);
+   } else if(marker_file) {
+      uint64_t start, end;
+      int i;
+      if(trace_read_markers(marker_file, &start, &end)) {
+         exit(1);
+      }
+      trace_set_markers(&trace, start, end, 0);
+      for(i=1; i<num_traces; ++i) {
+         trace_set_markers(&more_traces[i - 1], start, end, 0);
+      }
+   }
+   if(num_traces > 1 && !coherent) {
+      fprintf(stderr, "Several traces need -c\n");
+      exit(1);
+   }
+   if(num_set > 1 || num_block > 1 || num_policy > 1) {
+      sweep = 1;
+   }
+   if(sweep) {
+      if(verbose || classify_misses || num_levels > 1 || sampled || profile ||
+         write_given || prefetch_given || coherent || tlb_given ||
+         timing_given) {
+         fprintf(stderr, "A sweep cannot be combined with -v, -C, -L, -S, -P, "
+                 "-w, -p, -T, -D or -c\n");
+         exit(1);
+      }
+      return;
+   }
+   if(assoc < 1 || (max_assoc && max_assoc < assoc)) {
+      fprintf(stderr, "Invalid associativity\n");
+      exit(1);
+   }
+   if(!policy->valid_assoc(assoc) ||
+      (max_assoc && !policy->valid_assoc(max_assoc))) {
+      fprintf(stderr, "Policy %s does not support E=%d\n", policy->name,
+              max_assoc ? max_assoc : assoc);
+      exit(1);
+   }
+   if(max_assoc > assoc && policy != REPL_LRU) {
+      fprintf(stderr, "A range of associativities is only supported with "
+              "lru\n");
+      exit(1);
+   }
+   if(max_assoc > assoc && verbose) {
+      fprintf(stderr, "-v is not supported with a range of associativities\n");
+      exit(1);
+   }
+   if(max_assoc > assoc && num_threads > 1) {
+      fprintf(stderr, "-j is not supported with a range of associativities\n");
+      exit(1);
+   }
+   if(num_threads < 1 || (num_threads > 1 && verbose)) {
+      fprintf(stderr, "-j needs a positive thread count and excludes -v\n");
+      exit(1);
+   }
+   if(num_levels > 1 && (verbose || num_threads > 1 || max_assoc > assoc)) {
+      fprintf(stderr, "-L cannot be combined with -v, -j or an -E range\n");
+      exit(1);
+   }
+   if(classify_misses && (num_threads > 1 || max_assoc > assoc ||
+                          num_levels > 1)) {
+      fprintf(stderr, "-C cannot be combined with -j, -L or an -E range\n");
+      exit(1);
+   }
+   if(sampled && (verbose || classify_misses || num_threads > 1 ||
+                  max_assoc > assoc || num_levels > 1)) {
+      fprintf(stderr, "-S cannot be combined with -v, -C, -j, -L or an -E "
+              "range\n");
+      exit(1);
+   }
+   if((write_given || prefetch_given || tlb_given) &&
+      (num_threads > 1 || max_assoc > assoc || num_levels > 1 || sampled ||
+       profile || coherent)) {
+      fprintf(stderr, "-w, -p and -T cannot be combined with -j, -L, -S, -P, "
+              "-c or an -E range\n");
+      exit(1);
+   }
+   if(profile && (verbose || classify_misses || num_threads > 1 ||
+                  max_assoc > assoc || num_levels > 1 || sampled)) {
+      fprintf(stderr, "-P cannot be combined with -v, -C, -j, -L, -S or an "
+              "-E range\n");
+      exit(1);
+   }
+   if(coherent && (verbose || classify_misses || num_threads > 1 ||
+                   max_assoc > assoc || num_levels > 1 || sampled ||
+                   profile || write_given || prefetch_given)) {
+      fprintf(stderr, "-c cannot be combined with -v, -C, -j, -L, -S, -P, -w, "
+              "-p or an -E range\n");
+      exit(1);
+   }
+   if(timing_given && (verbose || classify_misses || num_threads > 1 ||
+                       max_assoc > assoc || sampled || profile ||
+                       write_given || prefetch_given || tlb_given ||
+                       coherent)) {
+      fprintf(stderr, "-D cannot be combined with -v, -C, -j, -S, -P, -w, -p, "
+              "-T, -c or an -E range\n");
+      exit(1);
+   }
+   if(coh_cfg.cores < 0 || coh_cfg.cores > COH_MAX_CORES ||
+      coh_cfg.quantum < 0 || hot_lines < 0) {
+      fprintf(stderr, "-c needs 1 to %d cores and a positive quantum\n",
+              COH_MAX_CORES);
+      exit(1);
+   }
 }
 
 
 
-void verbose_print(char* str) {
-   if(verbose) {
-      printf("%s", str);
+void run_assoc_range(void) {
+   stackdist_t sd;
+   trace_rec_t rec;
+   int e;
+
+   if(sd_init(&sd, set_bits, block_bits, assoc, max_assoc)) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+   while(trace_next(&trace, &rec)) {
+      sd_access(&sd, rec.op, rec.addr);
    }
+   sd_finish(&sd);
+
+   // one row per associativity
+   for(e=assoc; e<=max_assoc; ++e) {
+      char label[16];
+      sprintf(label, "E:%d", e);
+      print_stats_row(label, &sd.counts[e - assoc], "");
+   }
+   sd_free(&sd);
+   trace_close(&trace);
 }
 
 
 
-void data_load(int set_index, int line_index, long tag, int miss, long* tags,
-            char* valid, char* dirty, Queue* usage_queue, Node** usage_table) {
-   int line = set_index*assoc+line_index;
+void run_hierarchy(void) {
+   hier_t h;
+   timing_t timing;
+   trace_rec_t rec;
+   int i;
 
-   // checking hits
-   if(!miss){
-      cache_hit(line_index, set_index, usage_queue);
-      move_front(&usage_queue[set_index], usage_table[line]);
-   } else {
-      misses++;
-      verbose_print("miss ");
-
-      tags[line]=tag;
-      if(!valid[line]) { // line is not valid (cold miss)
-         valid[line] = 1;
-         usage_table[line] = enqueue(&usage_queue[set_index], line_index);
-      } else { // line is valid but tag isn't (conflict miss)
-         cache_eviction(line, dirty);
-         move_front(&usage_queue[set_index], (&usage_queue[set_index])->tail);
+   levels[0].set_bits = set_bits;
+   levels[0].assoc = assoc;
+   levels[0].block_bits = block_bits;
+   levels[0].policy = policy;
+   if(hier_init(&h, num_levels, levels, inclusion) ||
+      (timing_given && timing_init(&timing, &timing_cfg, &h))) {
+      exit(1);
+   }
+
+   while(trace_next(&trace, &rec)) {
+      long mem = h.mem_reads + h.mem_writes;
+      int level = hier_access(&h, rec.op, rec.addr);
+      if(timing_given && level != -1) {
+         timing_access(&timing, level, h.mem_reads + h.mem_writes - mem);
+      }
+   }
+
+   for(i=0; i<h.num_levels; ++i) {
+      char label[16], extra[48] = "";
+      sprintf(label, "L%d", i+1);
+      if(inclusion == HIER_INCLUSIVE) {
+         sprintf(extra, " back_invalidations:%ld", h.back_invalidations[i]);
       }
+      print_stats_row(label, &h.levels[i].stats, extra);
+   }
+   printf("memory reads:%ld writes:%ld\n", h.mem_reads, h.mem_writes);
+   if(timing_given) {
+      timing_print(stdout, &timing);
    }
+
+   hier_free(&h);
+   trace_close(&trace);
 }
 
 
 
-void data_store(int set_index, int line_index, long tag, int miss, long* tags,
-            char* valid,char* dirty, Queue* usage_queue, Node** usage_table) {
-   int line = set_index*assoc+line_index; // index in the array
+void run_sweep(void) {
+   trace_rec_t* recs;
+   sweep_row_t* rows;
+   long n;
+   int num_rows = 0;
+   int p, si, bi, ei;
 
-   // checking hits
-   if(!miss){
-      cache_hit(line_index, set_index, usage_queue);
-      move_front(&usage_queue[set_index], usage_table[line]);
-   } else {
-      misses++;
-      verbose_print("dirty miss ");
-
-      tags[line]=tag;
-      if(!valid[line]) { // line is not valid (cold miss)
-         valid[line] = 1;
-         usage_table[line] = enqueue(&usage_queue[set_index], line_index);
-      } else { // line is valid but tag isn't (conflict miss)
-         cache_eviction(line, dirty);
-         move_front(&usage_queue[set_index], (&usage_queue[set_index])->tail);
+   // defaults for the options not given
+   if(!num_set) set_list[num_set++] = 0;
+   if(!num_block) block_list[num_block++] = 0;
+   if(!num_assoc) assoc_list[num_assoc++] = 1;
+   if(!num_policy) policy_list[num_policy++] = REPL_LRU;
+
+   rows = (sweep_row_t*)calloc((size_t)num_policy * num_set * num_block *
+                               num_assoc, sizeof(sweep_row_t));
+   if(!rows || (n = sweep_load(&trace, &recs)) < 0) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+
+   // E innermost, so LRU rows of one geometry share a stack pass
+   for(p=0; p<num_policy; ++p) {
+      for(si=0; si<num_set; ++si) {
+         for(bi=0; bi<num_block; ++bi) {
+            for(ei=0; ei<num_assoc; ++ei) {
+               sweep_row_t* r = &rows[num_rows];
+               r->policy = policy_list[p];
+               r->set_bits = set_list[si];
+               r->block_bits = block_list[bi];
+               r->assoc = assoc_list[ei];
+               if(r->set_bits + r->block_bits > 62) {
+                  fprintf(stderr, "Skipping s=%d b=%d, too many address "
+                          "bits\n", r->set_bits, r->block_bits);
+                  continue;
+               }
+               if(r->assoc < 1 || !r->policy->valid_assoc(r->assoc)) {
+                  fprintf(stderr, "Skipping E=%d, not supported by %s\n",
+                          r->assoc, r->policy->name);
+                  continue;
+               }
+               num_rows++;
+            }
+         }
       }
    }
 
-   // data store will always set the dirty bit
-   if(!dirty[line]) {
-      dirty[line] = 1;
-      dirty_active+=1 << block_bits;
+   if(num_threads == 1) { // -j not given, using every CPU
+      num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+      if(num_threads < 1) {
+         num_threads = 1;
+      }
+   }
+   if(sweep_run(recs, n, rows, num_rows, num_threads)) {
+      fprintf(stderr, "Sweep failed, out of memory or threads\n");
+      exit(1);
    }
+   sweep_print(stdout, rows, num_rows, sweep_format);
+
+   free(rows);
+   free(recs);
+   trace_close(&trace);
 }
 
 
 
-void cache_eviction(int line, char* dirty) {
-   if(dirty[line]) {
-      verbose_print("dirty-eviction ");
-      dirty_active -= 1 << block_bits;
-      dirty_evicted += 1 << block_bits;
-      dirty[line] = 0;
-   } else {
-      verbose_print("eviction ");
+void run_sampled(void) {
+   sample_est_t est;
+   const cache_stats_t* st = &est.stats;
+
+   if(sample_run(&trace, set_bits, assoc, block_bits, policy, &sample_cfg,
+                 &est)) {
+      exit(1);
    }
+   printSummary(st->hits, st->misses, st->evictions, st->dirty_evicted,
+                st->dirty_active, st->double_accesses);
+   printf("ci95 hits:%.0f misses:%.0f evictions:%.0f samples:%ld/%.0f "
+          "simulated:%.4f\n", est.hits_ci, est.misses_ci, est.evictions_ci,
+          est.samples, est.population, est.fraction);
+   trace_close(&trace);
+}
 
-   evictions++;
+
+
+void run_profiled(void) {
+   cache_t c;
+   prof_report_t report;
+
+   if(cache_init(&c, set_bits, assoc, block_bits, policy)) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+   prof_run(&trace, &c, &report);
+   printSummary(c.stats.hits, c.stats.misses, c.stats.evictions,
+                c.stats.dirty_evicted, c.stats.dirty_active,
+                c.stats.double_accesses);
+   fflush(stdout);
+   prof_print(stderr, &report);
+
+   cache_free(&c);
+   trace_close(&trace);
 }
 
 
 
-void cache_hit(int line_index, int set_index, Queue* usage_queue) {
-   hits++;
-   if(line_index == peek_head(&usage_queue[set_index])) {
-      double_accesses++;
-      verbose_print("hit-double_ref ");
-   } else {
-      verbose_print("hit ");
+void run_coherent(void) {
+   coh_t h;
+   trace_t* traces[COH_MAX_CORES];
+   const coh_line_t** hot;
+   coh_stats_t total;
+   int cores, found, i;
+
+   traces[0] = &trace;
+   for(i=1; i<num_traces; ++i) {
+      traces[i] = &more_traces[i - 1];
+   }
+   cores = num_traces > 1 ? num_traces : coh_cfg.cores ? coh_cfg.cores : 4;
+   hot = (const coh_line_t**)calloc(hot_lines + 1, sizeof(*hot));
+   if(!hot || coh_init(&h, coh_cfg.protocol, cores, set_bits, assoc,
+                       block_bits, policy)) {
+      exit(1);
+   }
+   if(coh_run(&h, traces, num_traces, &coh_cfg)) {
+      exit(1);
+   }
+
+   memset(&total, 0, sizeof(total));
+   for(i=0; i<h.num_cores; ++i) {
+      const coh_stats_t* st = &h.stats[i];
+      char label[16], extra[160];
+      sprintf(label, "core%d", i);
+      sprintf(extra, " invalidations:%ld coherence_misses:%ld "
+              "false_sharing:%ld transfers:%ld upgrades:%ld",
+              st->invalidations, st->coherence_misses, st->false_sharing,
+              st->transfers, st->upgrades);
+      print_stats_row(label, &h.cores[i].stats, extra);
+      total.invalidations += st->invalidations;
+      total.coherence_misses += st->coherence_misses;
+      total.false_sharing += st->false_sharing;
+      total.transfers += st->transfers;
+      total.upgrades += st->upgrades;
+   }
+   printf("coherence invalidations:%ld coherence_misses:%ld "
+          "false_sharing:%ld transfers:%ld upgrades:%ld\n",
+          total.invalidations, total.coherence_misses, total.false_sharing,
+          total.transfers, total.upgrades);
+   printf("memory reads:%ld writes:%ld\n", h.mem_reads, h.mem_writes);
+
+   // the lines most worth padding or splitting
+   found = coh_hot_lines(&h, hot, hot_lines);
+   for(i=0; i<found; ++i) {
+      printf("hot_line addr:%llx invalidations:%ld false_sharing:%ld "
+             "true_sharing:%ld\n",
+             (unsigned long long)(hot[i]->block - 1) << block_bits,
+             hot[i]->invalidations, hot[i]->false_sharing,
+             hot[i]->true_sharing);
+   }
+
+   free(hot);
+   coh_free(&h);
+   trace_close(&trace);
+   for(i=1; i<num_traces; ++i) {
+      trace_close(&more_traces[i - 1]);
    }
 }
 
 
 
-void initialize_queue(Queue* q, int max_size) {
-   q->head = NULL;
-   q->tail = NULL;
+void parse_coherence(char* desc, coh_cfg_t* cfg) {
+   char* const keys[] = {"mesi", "moesi", "cores", "quantum", "seed", "hot",
+                         NULL};
+   char* value;
+
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || (key >= 2) != (value != NULL)) {
+         fprintf(stderr, "Bad coherence description, expected mesi|moesi"
+                 "[,cores=<n>][,quantum=<n>][,seed=<x>][,hot=<n>]\n");
+         exit(1);
+      }
+      switch(key) {
+         case 0:
+         case 1:
+         coh_parse_protocol(keys[key], &cfg->protocol);
+         break;
+
+         case 2:
+         cfg->cores = atoi(value);
+         break;
+
+         case 3:
+         cfg->quantum = atol(value);
+         break;
+
+         case 4:
+         cfg->seed = strtoul(value, NULL, 0);
+         break;
+
+         case 5:
+         hot_lines = atoi(value);
+         break;
+      }
+   }
 }
 
 
 
-Node* enqueue(Queue* q, int val) {
-   Node* new = (Node*)malloc(sizeof(Node));
-   new->val = val;
-   new->next=q->head;
+void parse_write(char* desc, csim_write_policy_t* policy) {
+   char* const keys[] = {"wb", "wt", "alloc", "noalloc", "wc", "sector", NULL};
+   char* value;
 
-   if(!q->head) {
-      q->head = new;
-      q->tail = new;
-   } else {
-      q->head->prev = new;
-      q->head = new;
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || (key >= 4) != (value != NULL)) {
+         fprintf(stderr, "Bad write policy, expected "
+                 "wb|wt,alloc|noalloc,wc=<n>,sector=<bytes>\n");
+         exit(1);
+      }
+      switch(key) {
+         case 0:
+         case 1:
+         policy->write_through = key == 1;
+         break;
+
+         case 2:
+         case 3:
+         policy->no_allocate = key == 3;
+         break;
+
+         case 4:
+         policy->combine_depth = atoi(value);
+         break;
+
+         case 5:
+         policy->sector_bytes = atoi(value);
+         break;
+      }
    }
-   return new;
 }
 
 
 
-int dequeue(Queue* q) {
-   if(!q->head) {
-      return -1;
-   } else {
-      int retval = q->tail->val; // storing the value to be dequeued
-      Node* old = q->tail;       // old node to be deleted
-      q->tail = q->tail->next;
-      q->tail->prev = NULL;
-      free(old);
-      return retval;
+void parse_prefetch(char* desc, csim_prefetch_t* cfg) {
+   char* const keys[] = {"next", "stride", "stream", "degree", "distance",
+                         "latency", NULL};
+   char* value;
+
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || (key >= 3) != (value != NULL)) {
+         fprintf(stderr, "Bad prefetcher, expected next|stride|stream"
+                 "[,degree=<n>][,distance=<n>][,latency=<n>]\n");
+         exit(1);
+      }
+      switch(key) {
+         case 0:
+         case 1:
+         case 2:
+         cfg->kind = keys[key];
+         break;
+
+         case 3:
+         cfg->degree = atoi(value);
+         break;
+
+         case 4:
+         cfg->distance = atoi(value);
+         break;
+
+         case 5:
+         cfg->latency = atoi(value);
+         break;
+      }
+   }
+   if(!cfg->kind) {
+      fprintf(stderr, "Name a prefetcher: next, stride or stream\n");
+      exit(1);
    }
 }
 
 
 
-int peek_head(Queue* q) {
-   return q->head->val;
+void parse_tlb(char* desc, tlb_cfg_t* cfg) {
+   char* const keys[] = {"l1", "l2", "l3", "page", "pwc", NULL};
+   char* value;
+   char* end;
+
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || !value) {
+         fprintf(stderr, "Bad TLB description, expected [l1=<entries>"
+                 "[:<ways>],l2=...,l3=...][,page=4k|2m|1g][,pwc=<entries>]\n");
+         exit(1);
+      }
+      switch(key) {
+         case 0:
+         case 1:
+         case 2:
+         if(key != cfg->num_levels) {
+            fprintf(stderr, "Give the TLB levels in order, from l1\n");
+            exit(1);
+         }
+         cfg->entries[key] = strtol(value, &end, 10);
+         cfg->assoc[key] = *end == ':' ? atoi(end + 1) : 0;
+         cfg->num_levels++;
+         break;
+
+         case 3:
+         if((cfg->page_bits = tlb_parse_page(value)) == -1) {
+            fprintf(stderr, "Unknown page size %s, choose from: 4k 2m 1g\n",
+                    value);
+            exit(1);
+         }
+         break;
+
+         case 4:
+         cfg->pwc_entries = atoi(value);
+         break;
+      }
+   }
 }
 
 
 
-int peek_tail(Queue* q) {
-   return q->tail->val;
+void parse_timing(char* desc, timing_cfg_t* cfg) {
+   char* const keys[] = {"lat", "mem", "bw", "mlp", "ghz", NULL};
+   char* value;
+   char* end;
+
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || !value) {
+         fprintf(stderr, "Bad timing description, expected lat=<L1>[:<L2>...],"
+                 "mem=<cycles>,bw=<bytes/cycle>,mlp=<n>,ghz=<f>\n");
+         exit(1);
+      }
+      switch(key) {
+         case 0: // latencies of the levels, colon separated
+         cfg->num_latencies = 0;
+         do {
+            if(cfg->num_latencies == HIER_MAX_LEVELS) {
+               fprintf(stderr, "At most %d latencies\n", HIER_MAX_LEVELS);
+               exit(1);
+            }
+            cfg->latency[cfg->num_latencies++] = strtol(value, &end, 10);
+            value = end + 1;
+         } while(*end == ':');
+         break;
+
+         case 1:
+         cfg->mem_latency = atoi(value);
+         break;
+
+         case 2:
+         cfg->bandwidth = atof(value);
+         break;
+
+         case 3:
+         cfg->mlp = atoi(value);
+         break;
+
+         case 4:
+         cfg->ghz = atof(value);
+         break;
+      }
+   }
 }
 
 
-void move_front(Queue* q, Node* n) {
-   if(!q->head) return;
 
-   if(n != q->head) {
-      // unlinking node
-      if(n->next)
-      n->next->prev = n->prev;
-      if(n->prev)
-      n->prev->next = n->next;
+void parse_sample(char* desc, sample_cfg_t* cfg) {
+   char* const keys[] = {"sets", "seed", "period", "window", "warmup", NULL};
+   char* value;
+
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || !value) {
+         fprintf(stderr, "Bad sample description, expected "
+                 "sets=<n>[,seed=<x>] or period=<n>,window=<n>[,warmup=<n>]\n");
+         exit(1);
+      }
+      switch(key) {
+         case 0:
+         cfg->sets = atol(value);
+         break;
+
+         case 1:
+         cfg->seed = strtoul(value, NULL, 0);
+         break;
+
+         case 2:
+         cfg->period = atol(value);
+         break;
+
+         case 3:
+         cfg->window = atol(value);
+         break;
 
-      // if the node is the tail
-      if(n == q->tail){
-         q->tail = n->prev;
-         q->tail->next = NULL;
+         case 4:
+         cfg->warmup = atol(value);
+         break;
       }
+   }
+}
+
+
 
-      // putting to front
-      n->next = q->head;
-      n->prev = NULL;
-      q->head->prev = n;
-      q->head = n;
+int parse_list(char opt, const char* arg, int* vals) {
+   int n = sweep_parse_ints(arg, vals, SWEEP_MAX_VALUES);
+   int i;
+   if(n < 1) {
+      fprintf(stderr, "Bad list for -%c: %s\n", opt, arg);
+      exit(1);
    }
+   for(i=0; i<n; ++i) {
+      if(vals[i] < 0 || (opt != 'E' && vals[i] > 62)) {
+         fprintf(stderr, "Bad value for -%c: %d\n", opt, vals[i]);
+         exit(1);
+      }
+      if(opt == 's' && vals[i] > CSIM_MAX_SET_BITS) {
+         fprintf(stderr, "Bad value for -s: %d, at most %d set bits are "
+                 "supported\n", vals[i], CSIM_MAX_SET_BITS);
+         exit(1);
+      }
+   }
+   return n;
 }
 
 
 
-void print_list(Queue* list) {
-   if(!list->head) { printf("List empty."); }
-   else { printf("List: "); }
-   Node *tmp = list->head;
-   while(tmp) {
-      printf("%d ", tmp->val);
-      tmp = tmp->next;
+void parse_level(char* desc, cache_geom_t* geom) {
+   char* const keys[] = {"s", "E", "b", "r", NULL};
+   char* value;
+   int seen = 0;
+
+   geom->policy = REPL_LRU;
+   while(*desc) {
+      int key = getsubopt(&desc, keys, &value);
+      if(key == -1 || !value) {
+         fprintf(stderr, "Bad level description, expected "
+                 "s=<s>,E=<E>,b=<b>[,r=<policy>]\n");
+         exit(1);
+      }
+      seen |= 1 << key;
+      switch(key) {
+         case 0:
+         geom->set_bits = atoi(value);
+         break;
+
+         case 1:
+         geom->assoc = atoi(value);
+         break;
+
+         case 2:
+         geom->block_bits = atoi(value);
+         break;
+
+         case 3:
+         if(!(geom->policy = repl_policy_find(value))) {
+            fprintf(stderr, "Unknown replacement policy %s\n", value);
+            exit(1);
+         }
+         break;
+      }
+   }
+   if((seen & 7) != 7 || geom->assoc < 1) {
+      fprintf(stderr, "Each level needs s, E and b\n");
+      exit(1);
+   }
+   if(geom->set_bits < 0 || geom->set_bits > CSIM_MAX_SET_BITS ||
+      geom->block_bits < 0 || geom->set_bits + geom->block_bits > 62) {
+      fprintf(stderr, "Bad level s=%d b=%d, s must be 0 to %d and s+b at "
+              "most 62\n", geom->set_bits, geom->block_bits,
+              CSIM_MAX_SET_BITS);
+      exit(1);
    }
-   printf("\n");
+}
+
+
+
+void print_stats_row(const char* label, const cache_stats_t* stats,
+                     const char* extra) {
+   printf("%s hits:%ld misses:%ld evictions:%ld dirty_bytes_evicted:%ld "
+          "dirty_bytes_active:%ld double_refs:%ld%s\n",
+          label, stats->hits, stats->misses, stats->evictions,
+          stats->dirty_evicted, stats->dirty_active, stats->double_accesses,
+          extra);
 }
@@ -27,6 +27,68 @@ def computeMissScore(miss, lower, upper, full_score):
     range = (upper- lower) * 1.0
     return round((1 - score / range) * full_score, 1)
 
+#
+# runCsim - run ./csim with the given arguments and return a list with
+# one dict of counters per row it prints
+#
+def runCsim(args):
+    p = subprocess.Popen("./csim " + args, 
+                         shell=True, stdout=subprocess.PIPE)
+    stdout_data = p.communicate()[0].decode("utf-8")
+    lines = [line for line in stdout_data.split("\n") if line]
+    if p.returncode != 0:
+        return []
+
+    # -o csv prints a header row and one row per configuration
+    if lines and lines[0].startswith("s,"):
+        keys = lines[0].split(",")
+        rows = [dict(zip(keys, line.split(","))) for line in lines[1:]]
+        for row in rows:
+            del row["miss_rate"]
+            del row["policy"]
+        return [dict((k, int(v)) for k, v in row.items()) for row in rows]
+    return [dict((k, int(v)) for k, v in re.findall(r'(\w+):(\d+)', line))
+            for line in lines]
+
+#
+# checkConsistency - check that -E ranges, -j and sweeps give the same
+# counters as single -E runs on every trace in traces/. Returns the
+# number of mismatches.
+#
+def checkConsistency():
+    configs = [(1, 1, 4, 1), (4, 1, 4, 4), (5, 1, 8, 5)]
+    threads = 4
+    errors = 0
+
+    traces = sorted(f for f in os.listdir("traces") if f.endswith(".trace"))
+    for trace in traces:
+        path = os.path.join("traces", trace)
+        for s, lo, hi, b in configs:
+            geometry = "-s %d -E %%s -b %d -t %s" % (s, b, path)
+            single = {}
+            for E in range(lo, hi + 1):
+                rows = runCsim(geometry % E)
+                single[E] = rows[0] if rows else None
+
+            ranged = runCsim(geometry % ("%d-%d" % (lo, hi)))
+            sweep = runCsim(geometry % ",".join(map(str, range(lo, hi + 1)))
+                            + " -o csv")
+            ranged = dict((row.pop("E"), row) for row in ranged)
+            sweep = dict((row.pop("E"), row) for row in sweep
+                         if row.pop("s") == s and row.pop("b") == b)
+
+            for E in range(lo, hi + 1):
+                runs = [("-E %d-%d" % (lo, hi), ranged.get(E)),
+                        ("sweep", sweep.get(E))]
+                rows = runCsim((geometry % E) + " -j %d" % threads)
+                runs.append(("-j %d" % threads, rows[0] if rows else None))
+                for name, row in runs:
+                    if single[E] is None or row != single[E]:
+                        print("%s: %s differs from -E %d with -s %d -b %d" %
+                              (trace, name, E, s, b))
+                        errors += 1
+    return errors
+
 #
 # main - Main function
 #
@@ -63,6 +125,14 @@ def main():
         else:
             print("%s" % (line))
 
+    # Check that the batched modes of csim agree with single runs
+    print("Running ./csim -E lo-hi, -j and sweeps against single -E runs")
+    mismatches = checkConsistency()
+    if mismatches:
+        print("%d mismatches" % mismatches)
+    else:
+        print("All runs match")
+
     # Check the correctness and performance of the transpose function
     # 32x32 transpose
     print("Part B: Testing transpose function")
@@ -0,0 +1,199 @@
+/*
+ * hier.c - Multi-level cache hierarchy (see hier.h)
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hier.h"
+
+/*
+ * level_access - Demand access to a level of a nine or inclusive
+ * hierarchy. Returns the level that supplied the data, as hier_access()
+ */
+static int level_access(hier_t* h, int level, char op, uint64_t addr);
+
+/* Handles a block evicted from a level of a nine or inclusive hierarchy */
+static void level_victim(hier_t* h, int level, uint64_t addr, int dirty);
+
+/*
+ * excl_fetch - Looks for a block L1 missed on in the levels from level
+ * down, removing it from the level that holds it. Returns whether the
+ * block was dirty, and stores the level that held it (num_levels for
+ * memory) in found.
+ */
+static int excl_fetch(hier_t* h, int level, uint64_t addr, int* found);
+
+/* Moves a block evicted from a level of an exclusive hierarchy down */
+static void excl_victim(hier_t* h, int level, uint64_t addr, int dirty);
+
+
+
+int hier_init(hier_t* h, int num_levels, const cache_geom_t* geoms,
+              hier_inclusion_t inclusion) {
+   int i;
+   memset(h, 0, sizeof(*h));
+   h->inclusion = inclusion;
+
+   if(num_levels < 1 || num_levels > HIER_MAX_LEVELS) {
+      fprintf(stderr, "A hierarchy has 1 to %d levels\n", HIER_MAX_LEVELS);
+      return -1;
+   }
+   for(i=0; i<num_levels; ++i) {
+      const cache_geom_t* g = &geoms[i];
+      if(i > 0 && g->block_bits < geoms[i-1].block_bits) {
+         fprintf(stderr, "L%d blocks are smaller than L%d blocks\n", i+1, i);
+         return -1;
+      }
+      if(i > 0 && inclusion == HIER_EXCLUSIVE &&
+         g->block_bits != geoms[0].block_bits) {
+         fprintf(stderr, "Exclusive levels must have equal block sizes\n");
+         return -1;
+      }
+      if(!g->policy->valid_assoc(g->assoc)) {
+         fprintf(stderr, "Policy %s does not support E=%d\n", g->policy->name,
+                 g->assoc);
+         return -1;
+      }
+      if(cache_init(&h->levels[i], g->set_bits, g->assoc, g->block_bits,
+                    g->policy)) {
+         fprintf(stderr, "Failed to allocate memory");
+         return -1;
+      }
+      h->num_levels = i+1;
+   }
+   return 0;
+}
+
+
+
+int hier_access(hier_t* h, char op, uint64_t addr) {
+   cache_result_t res;
+   int found = 0;
+
+   if(op == 'I') {
+      return -1;
+   }
+   if(h->inclusion != HIER_EXCLUSIVE) {
+      return level_access(h, 0, op, addr);
+   }
+
+   cache_access(&h->levels[0], op, addr, &res);
+   if(!res.hit && excl_fetch(h, 1, addr, &found)) {
+      cache_mark_dirty(&h->levels[0], addr);
+   }
+   if(res.evicted) {
+      excl_victim(h, 0, res.victim_addr, res.victim_dirty);
+   }
+   return found;
+}
+
+
+
+void hier_free(hier_t* h) {
+   int i;
+   for(i=0; i<h->num_levels; ++i) {
+      cache_free(&h->levels[i]);
+   }
+   h->num_levels = 0;
+}
+
+
+
+int hier_parse_inclusion(const char* name, hier_inclusion_t* inclusion) {
+   if(!strcmp(name, "nine")) {
+      *inclusion = HIER_NINE;
+   } else if(!strcmp(name, "inclusive")) {
+      *inclusion = HIER_INCLUSIVE;
+   } else if(!strcmp(name, "exclusive")) {
+      *inclusion = HIER_EXCLUSIVE;
+   } else {
+      return -1;
+   }
+   return 0;
+}
+
+
+
+static int level_access(hier_t* h, int level, char op, uint64_t addr) {
+   cache_result_t res;
+   int found = level;
+   cache_access(&h->levels[level], op, addr, &res);
+
+   // the fill is read from the next level before the victim is written back
+   if(!res.hit) {
+      if(level+1 < h->num_levels) {
+         found = level_access(h, level+1, 'L', addr);
+      } else {
+         h->mem_reads++;
+         found = h->num_levels;
+      }
+   }
+   if(res.evicted) {
+      level_victim(h, level, res.victim_addr, res.victim_dirty);
+   }
+   return found;
+}
+
+
+
+static void level_victim(hier_t* h, int level, uint64_t addr, int dirty) {
+   int i;
+
+   if(h->inclusion == HIER_INCLUSIVE) {
+      // back-invalidating every upper copy of the victim's bytes
+      uint64_t end = addr + (1UL << h->levels[level].block_bits);
+      for(i=0; i<level; ++i) {
+         uint64_t a;
+         for(a=addr; a<end; a+=1UL << h->levels[i].block_bits) {
+            int upper_dirty = cache_invalidate(&h->levels[i], a);
+            if(upper_dirty != -1) {
+               h->back_invalidations[i]++;
+               dirty |= upper_dirty;
+            }
+         }
+      }
+   }
+
+   if(dirty) {
+      if(level+1 < h->num_levels) {
+         level_access(h, level+1, 'S', addr);
+      } else {
+         h->mem_writes++;
+      }
+   }
+}
+
+
+
+static int excl_fetch(hier_t* h, int level, uint64_t addr, int* found) {
+   int dirty;
+   *found = level;
+   if(level == h->num_levels) {
+      h->mem_reads++;
+      return 0;
+   }
+
+   dirty = cache_invalidate(&h->levels[level], addr);
+   if(dirty != -1) {
+      h->levels[level].stats.hits++;
+      return dirty;
+   }
+   h->levels[level].stats.misses++;
+   return excl_fetch(h, level+1, addr, found);
+}
+
+
+
+static void excl_victim(hier_t* h, int level, uint64_t addr, int dirty) {
+   cache_result_t res;
+   if(level+1 == h->num_levels) {
+      if(dirty) {
+         h->mem_writes++;
+      }
+      return;
+   }
+
+   cache_insert(&h->levels[level+1], addr, dirty, &res);
+   if(res.evicted) {
+      excl_victim(h, level+1, res.victim_addr, res.victim_dirty);
+   }
+}
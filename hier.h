@@ -0,0 +1,67 @@
+/*
+ * hier.h - Multi-level cache hierarchy built from cache_t levels.
+ *
+ * Level 0 (L1) receives the trace. A miss at one level reads the block
+ * from the next, and dirty victims are written back to the next level as
+ * stores, so every level sees the traffic the level above generates.
+ * Three inclusion policies are modelled:
+ *
+ *   nine       non-inclusive non-exclusive: levels fill independently
+ *   inclusive  a victim of a lower level is invalidated in every level
+ *              above it (back-invalidation); dirty upper copies are
+ *              merged into the victim's write back
+ *   exclusive  a block lives in one level at a time: lower-level hits
+ *              move the block up, and every upper-level victim, clean or
+ *              dirty, is inserted into the level below
+ *
+ * Block sizes may not shrink going down, and must all be equal for the
+ * exclusive policy.
+ */
+#ifndef CSIM_HIER_H
+#define CSIM_HIER_H
+
+#include "cache.h"
+
+#define HIER_MAX_LEVELS 8
+
+typedef enum { HIER_NINE, HIER_INCLUSIVE, HIER_EXCLUSIVE } hier_inclusion_t;
+
+/* Geometry and replacement policy of one level */
+typedef struct cache_geom {
+   int set_bits;
+   int assoc;
+   int block_bits;
+   const repl_policy_t* policy;
+} cache_geom_t;
+
+typedef struct hier {
+   int num_levels;
+   hier_inclusion_t inclusion;
+   cache_t levels[HIER_MAX_LEVELS];
+   long back_invalidations[HIER_MAX_LEVELS];  /* lines removed per level */
+   long mem_reads;   /* blocks read from memory */
+   long mem_writes;  /* dirty blocks written to memory */
+} hier_t;
+
+/*
+ * hier_init - Builds a hierarchy of num_levels levels, L1 first. Returns
+ * 0 on success, and -1 with a message on stderr if the geometries do not
+ * suit the inclusion policy or memory could not be allocated.
+ */
+int hier_init(hier_t* h, int num_levels, const cache_geom_t* geoms,
+              hier_inclusion_t inclusion);
+
+/*
+ * hier_access - Simulates one access from the trace; op is 'L', 'S', 'M'
+ * or 'I'. Returns the level that supplied the data, 0 for an L1 hit and
+ * num_levels for memory, or -1 for 'I'.
+ */
+int hier_access(hier_t* h, char op, uint64_t addr);
+
+/* Frees every level */
+void hier_free(hier_t* h);
+
+/* Parses "nine", "inclusive" or "exclusive". Returns -1 if unknown */
+int hier_parse_inclusion(const char* name, hier_inclusion_t* inclusion);
+
+#endif /* CSIM_HIER_H */
@@ -0,0 +1,188 @@
+/*
+ * libcsim.c - Embeddable cache simulator (see libcsim.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "libcsim.h"
+#include "cache.h"
+#include "lookup.h"
+#include "prefetch.h"
+
+/* Records csim_run_trace() reads before simulating them */
+#define RUN_BATCH 256
+
+struct csim {
+   cache_t cache;
+   prefetcher_t* pf;  /* NULL without a prefetcher */
+};
+
+/* The kernel choice is made once per process, whoever creates first */
+static pthread_once_t lookup_once = PTHREAD_ONCE_INIT;
+
+/* pthread_once() callback selecting the tag lookup kernel */
+static void select_lookup(void);
+
+
+
+csim_t* csim_create(int set_bits, int assoc, int block_bits,
+                    const char* policy) {
+   const repl_policy_t* p = policy ? repl_policy_find(policy) : REPL_LRU;
+   csim_t* sim;
+
+   if(!p) {
+      fprintf(stderr, "Unknown replacement policy %s\n", policy);
+      return NULL;
+   }
+   if(set_bits < 0 || set_bits > CSIM_MAX_SET_BITS || block_bits < 0 ||
+      set_bits + block_bits > 62 ||
+      assoc < 1 || !p->valid_assoc(assoc)) {
+      fprintf(stderr, "Invalid cache s=%d E=%d b=%d for policy %s\n",
+              set_bits, assoc, block_bits, p->name);
+      return NULL;
+   }
+
+   pthread_once(&lookup_once, select_lookup);
+   if(!(sim = (csim_t*)calloc(1, sizeof(*sim))) ||
+      cache_init(&sim->cache, set_bits, assoc, block_bits, p)) {
+      fprintf(stderr, "Failed to allocate memory");
+      free(sim);
+      return NULL;
+   }
+   return sim;
+}
+
+
+
+int csim_access(csim_t* sim, char op, uint64_t addr) {
+   return csim_access_size(sim, op, addr, 0);
+}
+
+
+
+int csim_access_size(csim_t* sim, char op, uint64_t addr, unsigned int size) {
+   cache_result_t res;
+   if(op == 'I') {
+      return 0;
+   }
+   if(sim->pf) {
+      pf_access(sim->pf, &sim->cache, op, addr, size, &res);
+   } else {
+      cache_access_size(&sim->cache, op, addr, size, &res);
+   }
+   return res.hit;
+}
+
+
+
+void csim_access_batch(csim_t* sim, const trace_rec_t* recs, size_t n) {
+   size_t i;
+   if(sim->pf) {
+      for(i=0; i<n; ++i) {
+         pf_access(sim->pf, &sim->cache, recs[i].op, recs[i].addr,
+                   recs[i].size, NULL);
+      }
+      return;
+   }
+   for(i=0; i<n; ++i) {
+      cache_access_size(&sim->cache, recs[i].op, recs[i].addr, recs[i].size,
+                        NULL);
+   }
+}
+
+
+
+long csim_run_trace(csim_t* sim, trace_t* trace) {
+   trace_rec_t recs[RUN_BATCH];
+   long total = 0;
+   size_t n;
+
+   do {
+      for(n=0; n<RUN_BATCH && trace_next(trace, &recs[n]); ++n);
+      csim_access_batch(sim, recs, n);
+      total += n;
+   } while(n == RUN_BATCH);
+   return total;
+}
+
+
+
+int csim_set_write_policy(csim_t* sim, const csim_write_policy_t* policy) {
+   return cache_set_write_policy(&sim->cache, policy);
+}
+
+
+
+void csim_write_stats(const csim_t* sim, csim_write_stats_t* stats) {
+   cache_write_stats(&sim->cache, stats);
+}
+
+
+
+int csim_set_prefetcher(csim_t* sim, const csim_prefetch_t* prefetch) {
+   prefetcher_t* pf = (prefetcher_t*)malloc(sizeof(*pf));
+   if(!pf) {
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+   if(pf_init(pf, prefetch, &sim->cache)) {
+      free(pf);
+      return -1;
+   }
+   if(sim->pf) {
+      pf_free(sim->pf);
+      free(sim->pf);
+   }
+   sim->pf = pf;
+   return 0;
+}
+
+
+
+void csim_prefetch_stats(const csim_t* sim, csim_prefetch_stats_t* stats) {
+   if(sim->pf) {
+      *stats = sim->pf->stats;
+   } else {
+      memset(stats, 0, sizeof(*stats));
+   }
+}
+
+
+
+void csim_set_verbose(csim_t* sim, int on) {
+   sim->cache.verbose = on;
+}
+
+
+
+int csim_block_bits(const csim_t* sim) {
+   return sim->cache.block_bits;
+}
+
+
+
+void csim_stats(const csim_t* sim, csim_stats_t* stats) {
+   *stats = sim->cache.stats;
+}
+
+
+
+void csim_destroy(csim_t* sim) {
+   if(sim) {
+      if(sim->pf) {
+         pf_free(sim->pf);
+         free(sim->pf);
+      }
+      cache_free(&sim->cache);
+      free(sim);
+   }
+}
+
+
+
+static void select_lookup(void) {
+   if(!tag_lookup) { // the program may have picked a kernel already
+      lookup_init(NULL);
+   }
+}
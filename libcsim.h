@@ -0,0 +1,147 @@
+/*
+ * libcsim.h - Embeddable cache simulator.
+ *
+ * The engine behind csim, packaged as libcsim.a for programs that want to
+ * simulate accesses in-process instead of running csim on a trace file.
+ * Every simulator is an independent csim_t created with csim_create();
+ * the library keeps no simulation state in globals, so several
+ * simulators can run side by side, one per thread.
+ *
+ *     csim_t* sim = csim_create(5, 1, 5, NULL);
+ *     csim_access(sim, 'L', 0x1000);
+ *     csim_stats(sim, &stats);
+ *     csim_destroy(sim);
+ *
+ * Accesses are simulated exactly like csim does: write-allocate,
+ * write-back, LRU unless another policy is named (see policy.h), unless
+ * csim_set_write_policy() chooses other write handling.
+ */
+#ifndef CSIM_LIBCSIM_H
+#define CSIM_LIBCSIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "trace.h"
+
+/* Largest s a simulator can have, so that set counts fit an int */
+#define CSIM_MAX_SET_BITS 30
+
+typedef struct csim csim_t;
+
+/* The counters reported by printSummary() */
+typedef struct csim_stats {
+   long hits;
+   long misses;
+   long evictions;
+   long dirty_evicted;     /* bytes */
+   long dirty_active;      /* bytes */
+   long double_accesses;
+} csim_stats_t;
+
+/*
+ * How stores reach memory. The zero value is csim's default: write-back,
+ * write-allocate, no write-combining buffer, whole-block dirty bits.
+ */
+typedef struct csim_write_policy {
+   int write_through;   /* every store is also written to memory */
+   int no_allocate;     /* store misses go to memory without a fill */
+   int combine_depth;   /* blocks in the write-combining buffer, 0 = none */
+   int sector_bytes;    /* dirty tracking and memory write granularity, a
+                           power of two, 0 = the block size */
+} csim_write_policy_t;
+
+/* Memory write traffic of a simulator */
+typedef struct csim_write_stats {
+   long bytes;          /* bytes written to memory, whole sectors */
+   long writes;         /* write transactions sent to memory */
+   long merged;         /* writes merged into a buffered block */
+} csim_write_stats_t;
+
+/*
+ * A prefetcher inserting predicted blocks into the cache (see prefetch.h).
+ * kind is "next", "stride" or "stream"; zero degree and distance mean 1.
+ */
+typedef struct csim_prefetch {
+   const char* kind;
+   int degree;          /* blocks prefetched per trigger */
+   int distance;        /* how far ahead the first one is */
+   int latency;         /* demand accesses before a prefetch fills */
+} csim_prefetch_t;
+
+/* Prefetch counters, see prefetch.h */
+typedef struct csim_prefetch_stats {
+   long issued;
+   long useful;
+   long late;
+   long polluting;
+} csim_prefetch_stats_t;
+
+/*
+ * csim_create - Creates an empty cache of 2^s sets of E lines of 2^b
+ * bytes, replaced according to the named policy (NULL means "lru"). s
+ * may be at most CSIM_MAX_SET_BITS.
+ * Returns NULL, with a message on stderr, if the parameters are invalid
+ * or memory could not be allocated.
+ */
+csim_t* csim_create(int set_bits, int assoc, int block_bits,
+                    const char* policy);
+
+/*
+ * csim_access - Simulates one access; op is 'L', 'S', 'M' or 'I' ('I' is
+ * ignored). Returns 1 if the access (the load part of 'M') hit, else 0.
+ */
+int csim_access(csim_t* sim, char op, uint64_t addr);
+
+/*
+ * csim_access_size - Like csim_access(), for an access of size bytes, which
+ * is what dirties sectors (size 0 dirties the whole block)
+ */
+int csim_access_size(csim_t* sim, char op, uint64_t addr, unsigned int size);
+
+/* Simulates n trace records in order */
+void csim_access_batch(csim_t* sim, const trace_rec_t* recs, size_t n);
+
+/*
+ * csim_run_trace - Simulates every remaining record of an open trace.
+ * Returns the number of records read.
+ */
+long csim_run_trace(csim_t* sim, trace_t* trace);
+
+/* Prints the outcome of every access, as csim -v does, when on is set */
+void csim_set_verbose(csim_t* sim, int on);
+
+/*
+ * csim_set_write_policy - Chooses how stores reach memory. Call before
+ * the first access. Returns 0 on success, and -1 with a message on stderr
+ * if the sector size does not fit the block (at most 64 sectors) or
+ * memory could not be allocated.
+ */
+int csim_set_write_policy(csim_t* sim, const csim_write_policy_t* policy);
+
+/*
+ * csim_write_stats - Copies the memory write traffic so far into stats,
+ * counting the blocks still in the write-combining buffer as written
+ */
+void csim_write_stats(const csim_t* sim, csim_write_stats_t* stats);
+
+/*
+ * csim_set_prefetcher - Puts a prefetcher in front of the cache. Call
+ * before the first access. Returns 0 on success, and -1 with a message on
+ * stderr if the configuration is invalid or memory could not be
+ * allocated.
+ */
+int csim_set_prefetcher(csim_t* sim, const csim_prefetch_t* prefetch);
+
+/* Copies the prefetch counters so far into stats, zero if none is set */
+void csim_prefetch_stats(const csim_t* sim, csim_prefetch_stats_t* stats);
+
+/* Returns b, the log2 of the block size */
+int csim_block_bits(const csim_t* sim);
+
+/* Copies the counters accumulated so far into stats */
+void csim_stats(const csim_t* sim, csim_stats_t* stats);
+
+/* Frees a simulator created by csim_create() */
+void csim_destroy(csim_t* sim);
+
+#endif /* CSIM_LIBCSIM_H */
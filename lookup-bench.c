@@ -0,0 +1,129 @@
+/*
+ * lookup-bench.c - Micro-benchmark for the tag lookup kernels in lookup.c
+ *
+ * For each associativity, fills a cache of 2^s sets with random tags and
+ * times a stream of lookups against every kernel the host supports, and
+ * against the default choice of lookup_init(). The
+ * keys hit with probability 1/2, and half the misses find an invalid way,
+ * which roughly matches what csim sees on the handout traces.
+ *
+ *     linux> ./lookup-bench [-s <s>] [-n <lookups>]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include "lookup.h"
+
+#define NUM_KEYS 4096
+
+/* xorshift64, so every kernel sees the same inputs */
+static uint64_t rng_state = 88172645463325252UL;
+static uint64_t next_rand(void) {
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 7;
+   rng_state ^= rng_state << 17;
+   return rng_state;
+}
+
+static double now(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Prints the million lookups/sec of fn over the keys */
+static void time_kernel(lookup_fn fn, const uint64_t* tags, int assoc,
+                        const unsigned int* sets, const uint64_t* keys,
+                        long lookups) {
+   long n;
+   int cold;
+   long found = 0;
+   double start = now();
+
+   for(n=0; n<lookups; ++n) {
+      int j = n & (NUM_KEYS-1);
+      found += fn(&tags[sets[j]*assoc], assoc, keys[j], &cold) + cold;
+   }
+   printf("%16.1f", lookups / (now() - start) / 1e6);
+   // keeps the loop from being optimised away
+   if(found == 42) {
+      printf("*");
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   static const int assocs[] = {1, 2, 4, 8, 16, 32, 64};
+   int set_bits = 10;
+   long lookups = 20000000;
+   int opt, a, i;
+   const lookup_kernel_t* k;
+
+   while((opt = getopt(argc, argv, "s:n:")) != -1) {
+      switch(opt) {
+         case 's':
+         set_bits = atoi(optarg);
+         break;
+
+         case 'n':
+         lookups = atol(optarg);
+         break;
+
+         default:
+         fprintf(stderr, "Usage: %s [-s <s>] [-n <lookups>]\n", argv[0]);
+         exit(1);
+      }
+   }
+   lookup_init(NULL);
+
+   printf("%6s", "E");
+   for(k=lookup_kernels; k->name; ++k) {
+      if(k->supported()) {
+         printf("%16s", k->name);
+      }
+   }
+   printf("%16s   (million lookups/sec, %d sets)\n", "default",
+          1 << set_bits);
+
+   for(a=0; a<(int)(sizeof(assocs)/sizeof(assocs[0])); ++a) {
+      int assoc = assocs[a];
+      size_t lines = (size_t)assoc << set_bits;
+      uint64_t* tags = (uint64_t*)malloc(lines*sizeof(uint64_t));
+      uint64_t keys[NUM_KEYS];
+      unsigned int sets[NUM_KEYS];
+
+      if(!tags) {
+         fprintf(stderr, "Failed to allocate memory");
+         exit(1);
+      }
+      // one set in eight is partially filled so cold ways get found
+      for(i=0; i<(int)lines; ++i) {
+         tags[i] = (next_rand() >> 20) | LINE_VALID;
+         if((i / assoc) % 8 == 0 && i % assoc >= assoc/2) {
+            tags[i] = 0;
+         }
+      }
+      for(i=0; i<NUM_KEYS; ++i) {
+         sets[i] = next_rand() & ((1 << set_bits)-1);
+         if(next_rand() & 1) {
+            keys[i] = tags[sets[i]*assoc + next_rand() % assoc] | LINE_VALID;
+         } else {
+            keys[i] = (next_rand() >> 20) | LINE_VALID;
+         }
+      }
+
+      printf("%6d", assoc);
+      for(k=lookup_kernels; k->name; ++k) {
+         if(k->supported()) {
+            time_kernel(k->fn, tags, assoc, sets, keys, lookups);
+         }
+      }
+      time_kernel(lookup_for(assoc), tags, assoc, sets, keys, lookups);
+      printf("\n");
+      free(tags);
+   }
+   return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * lookup.c - Scalar, SSE4.2 and AVX2 tag lookup kernels (see lookup.h)
+ *
+ * The vector kernels are compiled with per-function target attributes, so
+ * the file builds with the default flags and the choice between kernels is
+ * made at runtime from the host's cpuid.
+ */
+#include <string.h>
+#include <immintrin.h>
+#include "lookup.h"
+
+lookup_fn tag_lookup;
+
+/* Set when lookup_init() was given a kernel name */
+static int named;
+
+
+
+static int lookup_scalar(const uint64_t* ways, int assoc, uint64_t key,
+                         int* cold) {
+   int i;
+   *cold = -1;
+   for(i=0; i<assoc; ++i) {
+      if(ways[i] == key) {
+         return i;
+      }
+      if(!ways[i] && *cold == -1) {
+         *cold = i;
+      }
+   }
+   return -1;
+}
+
+
+
+__attribute__((target("sse4.2")))
+static int lookup_sse(const uint64_t* ways, int assoc, uint64_t key,
+                      int* cold) {
+   int i;
+   const __m128i k = _mm_set1_epi64x(key);
+   const __m128i zero = _mm_setzero_si128();
+   *cold = -1;
+
+   // two ways per compare
+   for(i=0; i+2<=assoc; i+=2) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(ways+i));
+      int hit = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, k)));
+      if(hit) {
+         return i + __builtin_ctz(hit);
+      }
+      if(*cold == -1) {
+         int inv = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, zero)));
+         if(inv) {
+            *cold = i + __builtin_ctz(inv);
+         }
+      }
+   }
+
+   // odd associativity
+   if(i < assoc) {
+      if(ways[i] == key) {
+         return i;
+      }
+      if(!ways[i] && *cold == -1) {
+         *cold = i;
+      }
+   }
+   return -1;
+}
+
+
+
+__attribute__((target("avx2")))
+static int lookup_avx2(const uint64_t* ways, int assoc, uint64_t key,
+                       int* cold) {
+   int i;
+   const __m256i k = _mm256_set1_epi64x(key);
+   const __m256i zero = _mm256_setzero_si256();
+   *cold = -1;
+
+   // four ways per compare
+   for(i=0; i+4<=assoc; i+=4) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(ways+i));
+      int hit = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, k)));
+      if(hit) {
+         return i + __builtin_ctz(hit);
+      }
+      if(*cold == -1) {
+         int inv = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, zero)));
+         if(inv) {
+            *cold = i + __builtin_ctz(inv);
+         }
+      }
+   }
+
+   // the remaining 0-3 ways
+   for(; i<assoc; ++i) {
+      if(ways[i] == key) {
+         return i;
+      }
+      if(!ways[i] && *cold == -1) {
+         *cold = i;
+      }
+   }
+   return -1;
+}
+
+
+
+static int always_supported(void) {
+   return 1;
+}
+
+static int sse_supported(void) {
+   return __builtin_cpu_supports("sse4.2");
+}
+
+static int avx2_supported(void) {
+   return __builtin_cpu_supports("avx2");
+}
+
+const lookup_kernel_t lookup_kernels[] = {
+   {"scalar", lookup_scalar, always_supported},
+   {"sse4.2", lookup_sse, sse_supported},
+   {"avx2", lookup_avx2, avx2_supported},
+   {NULL, NULL, NULL}
+};
+
+
+
+const char* lookup_init(const char* name) {
+   const lookup_kernel_t* k;
+   const lookup_kernel_t* best = NULL;
+
+   __builtin_cpu_init();
+   for(k=lookup_kernels; k->name; ++k) {
+      if(name && strcmp(name, k->name)) {
+         continue;
+      }
+      if(k->supported()) {
+         best = k;
+      }
+   }
+
+   if(!best) {
+      return NULL;
+   }
+   tag_lookup = best->fn;
+   named = name != NULL;
+   return best->name;
+}
+
+
+
+lookup_fn lookup_for(int assoc) {
+   if(!tag_lookup) {
+      lookup_init(NULL);
+   }
+   if(!named && assoc < LOOKUP_SIMD_ASSOC) {
+      return lookup_scalar;
+   }
+   return tag_lookup;
+}
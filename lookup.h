@@ -0,0 +1,60 @@
+/*
+ * lookup.h - Tag lookup kernels for associative sets.
+ *
+ * Each line's tag word holds the tag with LINE_VALID set, and invalid
+ * lines hold 0, so a single compare against (tag | LINE_VALID) checks the
+ * tag and the valid bit together. Tags are at most 63 bits wide, which
+ * holds for every user-space address a trace can contain.
+ *
+ * The kernels compare a key against all ways of one set and return the
+ * hit way, plus the first invalid way when there is no hit. lookup_init()
+ * selects the widest kernel the host supports. Each cache searches its
+ * sets with lookup_for() its associativity, which is the scalar kernel
+ * below LOOKUP_SIMD_ASSOC ways unless a kernel was named: there the loop
+ * is too short for the vector setup to pay off (make lookup-bench).
+ */
+#ifndef CSIM_LOOKUP_H
+#define CSIM_LOOKUP_H
+
+#include <stdint.h>
+
+#define LINE_VALID (1UL << 63)
+
+/* Smallest associativity searched with a vector kernel by default */
+#define LOOKUP_SIMD_ASSOC 4
+
+/*
+ * lookup_fn - Searches ways[0..assoc-1] for key. Returns the hit way, or
+ * -1 on a miss, in which case *cold is set to the first invalid way (or
+ * -1 when the set is full).
+ */
+typedef int (*lookup_fn)(const uint64_t* ways, int assoc, uint64_t key,
+                         int* cold);
+
+/* A lookup kernel and the name used to select it */
+typedef struct lookup_kernel {
+   const char* name;
+   lookup_fn fn;
+   int (*supported)(void);
+} lookup_kernel_t;
+
+/* All kernels, narrowest first, terminated by a NULL name */
+extern const lookup_kernel_t lookup_kernels[];
+
+/* The kernel used by the simulator, set by lookup_init() */
+extern lookup_fn tag_lookup;
+
+/*
+ * lookup_init - Selects the kernel named by name, or the widest supported
+ * kernel when name is NULL. Returns the selected kernel's name, or NULL
+ * if name is unknown or not supported by this host.
+ */
+const char* lookup_init(const char* name);
+
+/*
+ * lookup_for - Returns the kernel for sets of assoc ways, calling
+ * lookup_init(NULL) first if no kernel was selected yet
+ */
+lookup_fn lookup_for(int assoc);
+
+#endif /* CSIM_LOOKUP_H */
@@ -0,0 +1,158 @@
+/*
+ * parsim.c - Set-partitioned multi-threaded simulation (see parsim.h)
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "parsim.h"
+
+/* Ring capacity in records, must be a power of two */
+#define RING_SIZE 16384
+
+/* Records the decoder collects for a worker before publishing them */
+#define BATCH_SIZE 256
+
+#define CACHE_LINE 64
+
+/*
+ * One worker and its ring. head is only written by the decoder and tail
+ * only by the worker, and each sits on its own host cache line.
+ */
+typedef struct worker {
+   pthread_t thread;
+   cache_t cache;
+   trace_rec_t* ring;
+   unsigned long head __attribute__((aligned(CACHE_LINE)));
+   int done;
+   unsigned long tail __attribute__((aligned(CACHE_LINE)));
+
+   // decoder-side staging, published a batch at a time
+   trace_rec_t batch[BATCH_SIZE] __attribute__((aligned(CACHE_LINE)));
+   int batch_len;
+} worker_t;
+
+/* Worker thread body: simulates records until the decoder is done */
+static void* worker_main(void* arg);
+
+/* Copies the decoder's staged batch into the worker's ring */
+static void publish_batch(worker_t* w);
+
+
+
+int parsim_run(trace_t* trace, int set_bits, int assoc, int block_bits,
+               const repl_policy_t* policy, int nworkers,
+               cache_stats_t* total) {
+   unsigned int num_sets = 1U << set_bits;
+   unsigned int sets_per_worker;
+   worker_t* workers;
+   trace_rec_t rec;
+   int i, started = 0, ret = 0;
+
+   if(nworkers > (int)num_sets) {
+      nworkers = num_sets;
+   }
+   sets_per_worker = (num_sets + nworkers - 1) / nworkers;
+   nworkers = (num_sets + sets_per_worker - 1) / sets_per_worker;
+
+   if(posix_memalign((void**)&workers, CACHE_LINE,
+                     nworkers * sizeof(worker_t))) {
+      return -1;
+   }
+   memset(workers, 0, nworkers * sizeof(worker_t));
+
+   for(i=0; i<nworkers; ++i) {
+      worker_t* w = &workers[i];
+      unsigned int first = i * sets_per_worker;
+      unsigned int count = num_sets - first < sets_per_worker ?
+                           num_sets - first : sets_per_worker;
+      w->ring = (trace_rec_t*)malloc(RING_SIZE * sizeof(trace_rec_t));
+      if(!w->ring ||
+         cache_init_sets(&w->cache, set_bits, assoc, block_bits, policy,
+                         first, count) ||
+         pthread_create(&w->thread, NULL, worker_main, w)) {
+         ret = -1;
+         break;
+      }
+      started++;
+   }
+
+   // decoding the trace once and routing each access by set
+   while(!ret && trace_next(trace, &rec)) {
+      worker_t* w;
+      if(rec.op == 'I') {
+         continue;
+      }
+      w = &workers[cache_set_index(set_bits, block_bits, rec.addr)
+                   / sets_per_worker];
+      w->batch[w->batch_len++] = rec;
+      if(w->batch_len == BATCH_SIZE) {
+         publish_batch(w);
+      }
+   }
+
+   for(i=0; i<started; ++i) {
+      publish_batch(&workers[i]);
+      __atomic_store_n(&workers[i].done, 1, __ATOMIC_RELEASE);
+   }
+
+   // merging the per-worker counters
+   memset(total, 0, sizeof(*total));
+   for(i=0; i<started; ++i) {
+      pthread_join(workers[i].thread, NULL);
+      cache_stats_add(total, &workers[i].cache.stats);
+   }
+   for(i=0; i<nworkers; ++i) {
+      cache_free(&workers[i].cache);
+      free(workers[i].ring);
+   }
+   free(workers);
+   return ret;
+}
+
+
+
+static void publish_batch(worker_t* w) {
+   unsigned long head = w->head;
+   int i;
+
+   // waiting for room in the ring
+   while(head + w->batch_len -
+         __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE) > RING_SIZE) {
+      sched_yield();
+   }
+   for(i=0; i<w->batch_len; ++i) {
+      w->ring[(head + i) & (RING_SIZE-1)] = w->batch[i];
+   }
+   __atomic_store_n(&w->head, head + w->batch_len, __ATOMIC_RELEASE);
+   w->batch_len = 0;
+}
+
+
+
+static void* worker_main(void* arg) {
+   worker_t* w = (worker_t*)arg;
+   unsigned long tail = 0;
+
+   for(;;) {
+      unsigned long head = __atomic_load_n(&w->head, __ATOMIC_ACQUIRE);
+      if(head == tail) {
+         // done is set after the last publish, so recheck head once more
+         if(__atomic_load_n(&w->done, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&w->head, __ATOMIC_ACQUIRE) == tail) {
+            break;
+         }
+         sched_yield();
+         continue;
+      }
+      while(tail != head) {
+         const trace_rec_t* rec = &w->ring[tail & (RING_SIZE-1)];
+         cache_access(&w->cache, rec->op, rec->addr, NULL);
+         tail++;
+      }
+      __atomic_store_n(&w->tail, tail, __ATOMIC_RELEASE);
+   }
+   return NULL;
+}
@@ -0,0 +1,27 @@
+/*
+ * parsim.h - Set-partitioned multi-threaded simulation.
+ *
+ * Sets never interact, so the sets of the cache are split into contiguous
+ * ranges, one per worker thread. The calling thread decodes the trace once
+ * and routes each access to the worker owning its set through a
+ * single-producer single-consumer ring buffer. Accesses to any one set are
+ * therefore simulated in trace order, and the merged counters are
+ * identical to a single-threaded run.
+ */
+#ifndef CSIM_PARSIM_H
+#define CSIM_PARSIM_H
+
+#include "cache.h"
+#include "trace.h"
+
+/*
+ * parsim_run - Simulates every access of trace on a 2^s x E x 2^b cache
+ * replaced according to policy, using nworkers threads (capped at the
+ * number of sets), and stores the merged counters in total. Returns 0 on
+ * success and -1 on failure.
+ */
+int parsim_run(trace_t* trace, int set_bits, int assoc, int block_bits,
+               const repl_policy_t* policy, int nworkers,
+               cache_stats_t* total);
+
+#endif /* CSIM_PARSIM_H */
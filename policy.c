@@ -0,0 +1,241 @@
+/*
+ * policy.c - Replacement policies (see policy.h)
+ *
+ *   lru     least recently used (the default, matches csim-ref)
+ *   fifo    first in first out, hits do not change the order
+ *   random  uniformly random way, from a per-set xorshift generator so
+ *           results do not depend on how sets are split across threads
+ *   plru    tree pseudo-LRU, E must be a power of two no larger than 64
+ *   nru     not recently used, one reference bit per line
+ *   srrip   static re-reference interval prediction, 2-bit RRPVs
+ *   brrip   bimodal RRIP, inserts at distant RRPV except 1 fill in 32
+ *   lfu     least frequently used, ties go to the lowest way
+ */
+#include <string.h>
+#include <stdint.h>
+#include "policy.h"
+#include "cache.h"
+
+/* Largest re-reference prediction value of the RRIP policies */
+#define RRPV_MAX 3
+
+/* One in BRRIP_EPSILON BRRIP fills is inserted at RRPV_MAX-1 */
+#define BRRIP_EPSILON 32
+
+#define LINE(c, set_index, way) ((set_index)*(c)->assoc + (way))
+
+/* Next value of a set's xorshift generator, which lives in repl_set */
+static uint64_t next_rand(cache_t* c, int set_index);
+
+/*
+ * min_way - Returns the way with the smallest per-line state, the lowest
+ * on ties. This is the victim for LRU, FIFO and LFU.
+ */
+static int min_way(cache_t* c, int set_index);
+
+
+
+static int any_assoc(int assoc) {
+   return assoc > 0;
+}
+
+static int pow2_assoc(int assoc) {
+   return assoc > 0 && assoc <= 64 && !(assoc & (assoc-1));
+}
+
+static void no_init(cache_t* c, int set_index) {
+}
+
+static void seed_init(cache_t* c, int set_index) {
+   // splitmix64 of the global set index, never zero
+   uint64_t z = (c->first_set + set_index + 1) * 0x9E3779B97F4A7C15UL;
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+   c->repl_set[set_index] = (z ^ (z >> 31)) | 1;
+}
+
+static uint64_t next_rand(cache_t* c, int set_index) {
+   uint64_t x = c->repl_set[set_index];
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   c->repl_set[set_index] = x;
+   return x;
+}
+
+static int min_way(cache_t* c, int set_index) {
+   const uint64_t* repl = &c->repl[LINE(c, set_index, 0)];
+   int i, way = 0;
+   for(i=1; i<c->assoc; ++i) {
+      if(repl[i] < repl[way]) {
+         way = i;
+      }
+   }
+   return way;
+}
+
+
+
+/******************************* LRU / FIFO *******************************/
+
+static void lru_touch(cache_t* c, int set_index, int way, int fill) {
+   c->repl[LINE(c, set_index, way)] = ++c->use_clock;
+}
+
+static void fifo_touch(cache_t* c, int set_index, int way, int fill) {
+   if(fill) {
+      c->repl[LINE(c, set_index, way)] = ++c->use_clock;
+   }
+}
+
+
+
+/********************************* Random *********************************/
+
+static void random_touch(cache_t* c, int set_index, int way, int fill) {
+}
+
+static int random_victim(cache_t* c, int set_index) {
+   return next_rand(c, set_index) % c->assoc;
+}
+
+
+
+/******************************** Tree PLRU *******************************/
+
+/*
+ * The assoc-1 tree nodes are numbered from 1 like a heap and node n's
+ * bit in repl_set points to the half of its subtree to evict from next
+ * (0 = left, 1 = right).
+ */
+static void plru_touch(cache_t* c, int set_index, int way, int fill) {
+   uint64_t bits = c->repl_set[set_index];
+   int node = 1;
+   int level;
+   int levels = __builtin_ctz(c->assoc);
+
+   for(level=levels-1; level>=0; --level) {
+      int dir = (way >> level) & 1;
+      // pointing the node away from the way just used
+      if(dir) {
+         bits &= ~(1UL << node);
+      } else {
+         bits |= 1UL << node;
+      }
+      node = 2*node + dir;
+   }
+   c->repl_set[set_index] = bits;
+}
+
+static int plru_victim(cache_t* c, int set_index) {
+   uint64_t bits = c->repl_set[set_index];
+   int node = 1;
+   while(node < c->assoc) {
+      node = 2*node + ((bits >> node) & 1);
+   }
+   return node - c->assoc;
+}
+
+
+
+/*********************************** NRU **********************************/
+
+static void nru_touch(cache_t* c, int set_index, int way, int fill) {
+   uint64_t* repl = &c->repl[LINE(c, set_index, 0)];
+   int i;
+   repl[way] = 1;
+
+   // once every line is referenced, all but this one are cleared
+   for(i=0; i<c->assoc; ++i) {
+      if(!repl[i]) {
+         return;
+      }
+   }
+   for(i=0; i<c->assoc; ++i) {
+      repl[i] = i == way;
+   }
+}
+
+static int nru_victim(cache_t* c, int set_index) {
+   const uint64_t* repl = &c->repl[LINE(c, set_index, 0)];
+   int i;
+   for(i=0; i<c->assoc; ++i) {
+      if(!repl[i]) {
+         return i;
+      }
+   }
+   return 0;
+}
+
+
+
+/******************************* SRRIP / BRRIP *****************************/
+
+static void srrip_touch(cache_t* c, int set_index, int way, int fill) {
+   c->repl[LINE(c, set_index, way)] = fill ? RRPV_MAX-1 : 0;
+}
+
+static void brrip_touch(cache_t* c, int set_index, int way, int fill) {
+   uint64_t rrpv = 0;
+   if(fill) {
+      rrpv = next_rand(c, set_index) % BRRIP_EPSILON ? RRPV_MAX : RRPV_MAX-1;
+   }
+   c->repl[LINE(c, set_index, way)] = rrpv;
+}
+
+static int rrip_victim(cache_t* c, int set_index) {
+   uint64_t* repl = &c->repl[LINE(c, set_index, 0)];
+   int way = 0;
+   int i;
+
+   // find the line with the largest RRPV and age the set to match
+   for(i=1; i<c->assoc; ++i) {
+      if(repl[i] > repl[way]) {
+         way = i;
+      }
+   }
+   if(repl[way] < RRPV_MAX) {
+      uint64_t age = RRPV_MAX - repl[way];
+      for(i=0; i<c->assoc; ++i) {
+         repl[i] += age;
+      }
+   }
+   return way;
+}
+
+
+
+/*********************************** LFU **********************************/
+
+static void lfu_touch(cache_t* c, int set_index, int way, int fill) {
+   uint64_t* count = &c->repl[LINE(c, set_index, way)];
+   *count = fill ? 1 : *count + 1;
+}
+
+
+
+/******************************** Registry ********************************/
+
+const repl_policy_t repl_policies[] = {
+   {"lru", any_assoc, no_init, lru_touch, min_way},
+   {"fifo", any_assoc, no_init, fifo_touch, min_way},
+   {"random", any_assoc, seed_init, random_touch, random_victim},
+   {"plru", pow2_assoc, no_init, plru_touch, plru_victim},
+   {"nru", any_assoc, no_init, nru_touch, nru_victim},
+   {"srrip", any_assoc, no_init, srrip_touch, rrip_victim},
+   {"brrip", any_assoc, seed_init, brrip_touch, rrip_victim},
+   {"lfu", any_assoc, no_init, lfu_touch, min_way},
+   {NULL, NULL, NULL, NULL, NULL}
+};
+
+
+
+const repl_policy_t* repl_policy_find(const char* name) {
+   const repl_policy_t* p;
+   for(p=repl_policies; p->name; ++p) {
+      if(!strcmp(p->name, name)) {
+         return p;
+      }
+   }
+   return NULL;
+}
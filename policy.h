@@ -0,0 +1,42 @@
+/*
+ * policy.h - Replacement policies for the cache model in cache.c.
+ *
+ * A policy keeps its state in two flat arrays owned by the cache: one
+ * 64-bit word per line (c->repl, set-major like c->tags) and one 64-bit
+ * word per set (c->repl_set). Both start out zeroed apart from whatever
+ * the policy's init hook writes, and nothing is allocated per access.
+ *
+ * The cache calls touch() on every hit and fill, and victim() when a miss
+ * finds no invalid way in the set.
+ */
+#ifndef CSIM_POLICY_H
+#define CSIM_POLICY_H
+
+struct cache;
+
+typedef struct repl_policy {
+   const char* name;
+
+   /* Returns nonzero if the policy can manage sets of assoc ways */
+   int (*valid_assoc)(int assoc);
+
+   /* Initialises the state of set set_index (local to the cache) */
+   void (*init)(struct cache* c, int set_index);
+
+   /* Records a use of a way: fill is 1 when the line was just filled */
+   void (*touch)(struct cache* c, int set_index, int way, int fill);
+
+   /* Chooses the way to evict from a full set */
+   int (*victim)(struct cache* c, int set_index);
+} repl_policy_t;
+
+/* All policies, LRU first, terminated by a NULL name */
+extern const repl_policy_t repl_policies[];
+
+/* The default policy, matching csim-ref */
+#define REPL_LRU (&repl_policies[0])
+
+/* Returns the policy called name, or NULL if there is none */
+const repl_policy_t* repl_policy_find(const char* name);
+
+#endif /* CSIM_POLICY_H */
@@ -0,0 +1,304 @@
+/*
+ * prefetch.c - Next-line, stride and stream prefetchers (see prefetch.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+
+/* Slot of a block in the tracked and victims tables */
+static inline size_t table_slot(prefetcher_t* p, uint64_t block);
+
+/* Removes block from a table. Returns 1 if it was there */
+static int table_take(prefetcher_t* p, uint64_t* table, uint64_t block);
+
+/* Fills the prefetches whose latency has passed */
+static void retire(prefetcher_t* p, cache_t* c);
+
+/* Inserts a prefetched block into the cache */
+static void fill(prefetcher_t* p, cache_t* c, uint64_t block);
+
+/* Prefetches block unless it is cached or already in flight */
+static void issue(prefetcher_t* p, cache_t* c, uint64_t block);
+
+/* Trains the stride table on an access and issues its prefetches */
+static void train_stride(prefetcher_t* p, cache_t* c, uint64_t addr);
+
+/* Trains the stream trackers on a miss or prefetch hit */
+static void train_stream(prefetcher_t* p, cache_t* c, uint64_t block);
+
+
+
+int pf_init(prefetcher_t* p, const prefetch_cfg_t* cfg, const cache_t* c) {
+   size_t slots = 1;
+   size_t lines = (size_t)c->num_sets * c->assoc;
+
+   memset(p, 0, sizeof(*p));
+   if(!strcmp(cfg->kind, "next")) {
+      p->kind = PF_NEXT;
+   } else if(!strcmp(cfg->kind, "stride")) {
+      p->kind = PF_STRIDE;
+   } else if(!strcmp(cfg->kind, "stream")) {
+      p->kind = PF_STREAM;
+   } else {
+      fprintf(stderr, "Unknown prefetcher %s, choose from: next stride "
+              "stream\n", cfg->kind);
+      return -1;
+   }
+   p->degree = cfg->degree ? cfg->degree : 1;
+   p->distance = cfg->distance ? cfg->distance : 1;
+   p->latency = cfg->latency;
+   p->block_bits = c->block_bits;
+   if(p->degree < 1 || p->degree > PF_QUEUE || p->distance < 1 ||
+      p->latency < 0) {
+      fprintf(stderr, "Prefetch degree must be 1 to %d, distance positive "
+              "and latency not negative\n", PF_QUEUE);
+      return -1;
+   }
+
+   while(slots < 4 * lines) {
+      slots <<= 1;
+   }
+   p->table_mask = slots - 1;
+   p->tracked = (uint64_t*)calloc(slots, sizeof(uint64_t));
+   p->victims = (uint64_t*)calloc(slots, sizeof(uint64_t));
+   if(!p->tracked || !p->victims) {
+      pf_free(p);
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+   return 0;
+}
+
+
+
+void pf_access(prefetcher_t* p, cache_t* c, char op, uint64_t addr,
+               unsigned int size, cache_result_t* res) {
+   uint64_t block = addr >> p->block_bits;
+   cache_result_t r;
+   int prefetch_hit = 0;
+   int i;
+
+   if(op == 'I') {
+      return;
+   }
+   p->now++;
+   retire(p, c);
+
+   // a demand access overtaking its prefetch
+   for(i=0; i<p->queue_used; ++i) {
+      pf_pending_t* e = &p->queue[(p->queue_head + i) % PF_QUEUE];
+      if(e->block == block + 1) {
+         e->block = 0;
+         p->stats.late++;
+      }
+   }
+
+   cache_access_size(c, op, addr, size, &r);
+   if(r.evicted) {
+      table_take(p, p->tracked, r.victim_addr >> p->block_bits);
+   }
+   if(r.hit) {
+      prefetch_hit = table_take(p, p->tracked, block);
+      p->stats.useful += prefetch_hit;
+   } else {
+      p->stats.polluting += table_take(p, p->victims, block);
+   }
+   if(res) {
+      *res = r;
+   }
+
+   switch(p->kind) {
+      case PF_NEXT:
+      if(!r.hit || prefetch_hit) {
+         for(i=0; i<p->degree; ++i) {
+            issue(p, c, block + p->distance + i);
+         }
+      }
+      break;
+
+      case PF_STRIDE:
+      train_stride(p, c, addr);
+      break;
+
+      case PF_STREAM:
+      if(!r.hit || prefetch_hit) {
+         train_stream(p, c, block);
+      }
+      break;
+   }
+}
+
+
+
+void pf_free(prefetcher_t* p) {
+   free(p->tracked);
+   free(p->victims);
+   p->tracked = NULL;
+   p->victims = NULL;
+}
+
+
+
+static inline size_t table_slot(prefetcher_t* p, uint64_t block) {
+   return (block * 0x9e3779b97f4a7c15ULL >> 32) & p->table_mask;
+}
+
+
+
+static int table_take(prefetcher_t* p, uint64_t* table, uint64_t block) {
+   size_t slot = table_slot(p, block);
+   if(table[slot] == block + 1) {
+      table[slot] = 0;
+      return 1;
+   }
+   return 0;
+}
+
+
+
+static void retire(prefetcher_t* p, cache_t* c) {
+   while(p->queue_used && p->queue[p->queue_head].ready <= p->now) {
+      pf_pending_t* e = &p->queue[p->queue_head];
+      if(e->block) {
+         fill(p, c, e->block - 1);
+      }
+      p->queue_head = (p->queue_head + 1) % PF_QUEUE;
+      p->queue_used--;
+   }
+}
+
+
+
+static void fill(prefetcher_t* p, cache_t* c, uint64_t block) {
+   uint64_t addr = block << p->block_bits;
+   int set_index = cache_set_index(c->set_bits, c->block_bits, addr)
+                   - c->first_set;
+   int mru = c->mru[set_index];
+   int verbose = c->verbose;
+   cache_result_t r;
+
+   // a fill is not a use: double references and -v only see demand accesses
+   c->verbose = 0;
+   cache_insert(c, addr, 0, &r);
+   c->verbose = verbose;
+   c->mru[set_index] = mru;
+   if(r.hit) {
+      return;
+   }
+   p->tracked[table_slot(p, block)] = block + 1;
+   if(r.evicted) {
+      uint64_t victim = r.victim_addr >> p->block_bits;
+      table_take(p, p->tracked, victim);
+      p->victims[table_slot(p, victim)] = victim + 1;
+   }
+}
+
+
+
+static void issue(prefetcher_t* p, cache_t* c, uint64_t block) {
+   int i;
+   if(cache_contains(c, block << p->block_bits)) {
+      return;
+   }
+   for(i=0; i<p->queue_used; ++i) {
+      if(p->queue[(p->queue_head + i) % PF_QUEUE].block == block + 1) {
+         return;
+      }
+   }
+   p->stats.issued++;
+
+   if(!p->latency) {
+      fill(p, c, block);
+      return;
+   }
+   if(p->queue_used == PF_QUEUE) { // the oldest arrives early
+      pf_pending_t* e = &p->queue[p->queue_head];
+      if(e->block) {
+         fill(p, c, e->block - 1);
+      }
+      p->queue_head = (p->queue_head + 1) % PF_QUEUE;
+      p->queue_used--;
+   }
+   i = (p->queue_head + p->queue_used++) % PF_QUEUE;
+   p->queue[i].block = block + 1;
+   p->queue[i].ready = p->now + p->latency;
+}
+
+
+
+static void train_stride(prefetcher_t* p, cache_t* c, uint64_t addr) {
+   uint64_t region = addr >> PF_REGION_BITS;
+   pf_stride_t* e = &p->strides[region % PF_STRIDE_ENTRIES];
+   int64_t stride;
+   int i;
+
+   if(e->region != region + 1) {
+      e->region = region + 1;
+      e->last = addr;
+      e->stride = 0;
+      e->confidence = 0;
+      return;
+   }
+   stride = (int64_t)(addr - e->last);
+   if(!stride) {
+      return;
+   }
+   e->last = addr;
+   if(stride == e->stride) {
+      e->confidence += e->confidence < 3;
+   } else if(e->confidence > 0) {
+      e->confidence--;
+   } else {
+      e->stride = stride;
+   }
+   if(e->confidence < 2) {
+      return;
+   }
+
+   for(i=0; i<p->degree; ++i) {
+      int64_t ahead = (int64_t)(p->distance + i);
+      if(stride < (1L << p->block_bits) && -stride < (1L << p->block_bits)) {
+         int64_t dir = stride > 0 ? 1 : -1;
+         issue(p, c, (addr >> p->block_bits) + dir * ahead);
+      } else {
+         issue(p, c, (addr + stride * ahead) >> p->block_bits);
+      }
+   }
+}
+
+
+
+static void train_stream(prefetcher_t* p, cache_t* c, uint64_t block) {
+   pf_stream_t* lru = &p->streams[0];
+   int i, k;
+
+   for(i=0; i<PF_STREAMS; ++i) {
+      pf_stream_t* s = &p->streams[i];
+      int64_t d = (int64_t)(block - s->last);
+      if(!s->used) {
+         lru = s;
+         continue;
+      }
+      if((s->dir && d * s->dir > 0 && d * s->dir <= p->distance + p->degree) ||
+         (!s->dir && (d == 1 || d == -1))) {
+         if(!s->dir) {
+            s->dir = (int)d;
+         }
+         s->last = block;
+         s->used = p->now;
+         for(k=0; k<p->degree; ++k) {
+            issue(p, c, block + s->dir * (int64_t)(p->distance + k));
+         }
+         return;
+      }
+      if(lru->used && s->used < lru->used) {
+         lru = s;
+      }
+   }
+
+   // starting a new stream in place of the least recently used one
+   lru->last = block;
+   lru->dir = 0;
+   lru->used = p->now;
+}
@@ -0,0 +1,108 @@
+/*
+ * prefetch.h - Hardware prefetchers in front of a cache_t.
+ *
+ * A prefetcher watches the demand accesses of a cache and inserts the
+ * blocks it predicts straight into the same cache (cache_insert()), where
+ * they compete with demand blocks for lines. Three are modelled:
+ *
+ *   next    tagged next-line: a demand miss, or the first demand hit on a
+ *           prefetched block, prefetches the blocks distance..
+ *           distance+degree-1 after it
+ *   stride  a table of PF_STRIDE_ENTRIES regions of 2^PF_REGION_BITS bytes,
+ *           each learning the stride between its accesses. Once the same
+ *           stride is seen twice, degree accesses distance strides ahead
+ *           are prefetched (strides under a block step a block at a time)
+ *   stream  PF_STREAMS stream trackers. Two misses to adjacent blocks
+ *           start a stream in their direction; a miss or prefetch hit
+ *           within distance+degree blocks ahead of a stream advances it
+ *           and prefetches degree blocks distance ahead
+ *
+ * With latency set, a prefetch only fills its line after that many more
+ * demand accesses; a demand access to a block still in flight is counted
+ * as late and fetched as a normal miss.
+ *
+ *   issued     prefetches sent to memory (the block was neither cached nor
+ *              already in flight)
+ *   useful     prefetched blocks hit by a demand access before eviction
+ *   late       demand accesses to blocks whose prefetch was in flight
+ *   polluting  demand misses to blocks a prefetch had evicted
+ *
+ * Prefetched and evicted blocks are remembered in direct-mapped tables of
+ * four entries per cache line, so heavy aliasing can make useful and
+ * polluting slight underestimates.
+ */
+#ifndef CSIM_PREFETCH_H
+#define CSIM_PREFETCH_H
+
+#include "cache.h"
+
+/* Configuration and counters, as exposed by libcsim */
+typedef csim_prefetch_t prefetch_cfg_t;
+typedef csim_prefetch_stats_t prefetch_stats_t;
+
+#define PF_STRIDE_ENTRIES 64
+#define PF_REGION_BITS 12
+#define PF_STREAMS 8
+#define PF_QUEUE 64
+
+typedef enum { PF_NEXT, PF_STRIDE, PF_STREAM } pf_kind_t;
+
+typedef struct pf_stride {
+   uint64_t region;     /* region number + 1, 0 = unused */
+   uint64_t last;       /* address of the last access */
+   int64_t stride;
+   int confidence;      /* 0 to 3, prefetching from 2 */
+} pf_stride_t;
+
+typedef struct pf_stream {
+   uint64_t last;       /* last block of the stream */
+   int dir;             /* +1, -1, or 0 while training */
+   unsigned long used;  /* time of the last use, for replacement */
+} pf_stream_t;
+
+typedef struct pf_pending {
+   uint64_t block;      /* block number + 1, 0 = cancelled */
+   unsigned long ready; /* demand access count at which it fills */
+} pf_pending_t;
+
+typedef struct prefetcher {
+   pf_kind_t kind;
+   int degree;
+   int distance;
+   int latency;
+   int block_bits;
+   unsigned long now;   /* demand accesses so far */
+
+   // block number + 1 of prefetched unused blocks and of prefetch victims
+   uint64_t* tracked;
+   uint64_t* victims;
+   size_t table_mask;
+
+   pf_stride_t strides[PF_STRIDE_ENTRIES];
+   pf_stream_t streams[PF_STREAMS];
+   pf_pending_t queue[PF_QUEUE];  /* in flight, FIFO */
+   int queue_head;
+   int queue_used;
+
+   prefetch_stats_t stats;
+} prefetcher_t;
+
+/*
+ * pf_init - Prepares a prefetcher for cache c. Returns 0 on success, and
+ * -1 with a message on stderr for an unknown kind, a bad parameter or a
+ * failed allocation.
+ */
+int pf_init(prefetcher_t* p, const prefetch_cfg_t* cfg, const cache_t* c);
+
+/*
+ * pf_access - Simulates a demand access of size bytes on c, as
+ * cache_access_size() does, then trains the prefetcher and issues its
+ * prefetches
+ */
+void pf_access(prefetcher_t* p, cache_t* c, char op, uint64_t addr,
+               unsigned int size, cache_result_t* res);
+
+/* Frees the prefetcher's tables */
+void pf_free(prefetcher_t* p);
+
+#endif /* CSIM_PREFETCH_H */
@@ -0,0 +1,209 @@
+/*
+ * profile.c - Phase timing and hardware counters for csim -P (see
+ * profile.h)
+ */
+#define _GNU_SOURCE // for syscall()
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "profile.h"
+
+/* Records read from the trace per timed decode */
+#define PROF_BATCH 256
+
+/*
+ * One batch in this many has its cache_access() phases timed, keeping the
+ * timer reads from swamping the rest of the run
+ */
+#define PROF_TIMED_EVERY 16
+
+/* Timer reads used to measure the cost of a timer read */
+#define PROF_CALIBRATE 1000
+
+/* The counters of prof_report_t.hw, in order */
+static const struct {
+   const char* name;
+   uint64_t config;
+} hw_events[PROF_HW_COUNTERS] = {
+   {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+   {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+   {"llc_misses", PERF_COUNT_HW_CACHE_MISSES},
+   {"branch_misses", PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+/*
+ * hw_open - Opens a disabled counter of this process for each hardware
+ * event, storing -1 for the ones the kernel refuses and the first reason
+ * in report->hw_error
+ */
+static void hw_open(int* fds, prof_report_t* report);
+
+/* Ticks a back to back pair of prof_ticks() calls costs at best */
+static uint64_t tick_overhead(void);
+
+/* Current wall clock time in seconds */
+static double wall_time(void);
+
+
+
+void prof_run(trace_t* trace, cache_t* c, prof_report_t* report) {
+   trace_rec_t recs[PROF_BATCH];
+   cache_prof_t phases = {0, 0};
+   int fds[PROF_HW_COUNTERS];
+   uint64_t overhead = tick_overhead();
+   uint64_t start, t;
+   long timed = 0, batches = 0, lookups = 0;
+   double begin, scale;
+   size_t n, i;
+
+   memset(report, 0, sizeof(*report));
+   hw_open(fds, report);
+
+   for(i=0; i<PROF_HW_COUNTERS; ++i) {
+      if(fds[i] != -1) {
+         ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+         ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+      }
+   }
+   begin = wall_time();
+   start = prof_ticks();
+
+   do {
+      t = prof_ticks();
+      for(n=0; n<PROF_BATCH && trace_next(trace, &recs[n]); ++n);
+      report->decode += prof_ticks() - t;
+      c->prof = batches++ % PROF_TIMED_EVERY ? NULL : &phases;
+      for(i=0; i<n; ++i) {
+         cache_access(c, recs[i].op, recs[i].addr, NULL);
+         lookups += recs[i].op != 'I';
+         timed += c->prof && recs[i].op != 'I';
+      }
+      report->accesses += n;
+   } while(n == PROF_BATCH);
+
+   report->total = prof_ticks() - start;
+   report->seconds = wall_time() - begin;
+   for(i=0; i<PROF_HW_COUNTERS; ++i) {
+      if(fds[i] != -1) {
+         ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+         if(read(fds[i], &report->hw[i], sizeof(uint64_t)) !=
+            sizeof(uint64_t)) {
+            report->hw[i] = 0;
+         }
+         close(fds[i]);
+      }
+   }
+   c->prof = NULL;
+
+   // each timed interval includes about one timer read, and the timed
+   // batches stand for all of them
+   scale = timed ? (double)lookups / timed : 0;
+   report->timer = overhead;
+   report->lookup = 0;
+   report->update = 0;
+   if(phases.lookup > timed * overhead) {
+      report->lookup = (phases.lookup - timed * overhead) * scale;
+   }
+   if(phases.update > timed * overhead) {
+      report->update = (phases.update - timed * overhead) * scale;
+   }
+}
+
+
+
+void prof_print(FILE* out, const prof_report_t* r) {
+   const char* names[] = {"decode", "lookup", "update", "other"};
+   uint64_t ticks[4];
+   uint64_t total = r->total ? r->total : 1;
+   long accesses = r->accesses ? r->accesses : 1;
+   int i;
+
+   ticks[0] = r->decode;
+   ticks[1] = r->lookup;
+   ticks[2] = r->update;
+   ticks[3] = r->total - r->decode - r->lookup - r->update;
+   if(r->decode + r->lookup + r->update > r->total) {
+      ticks[3] = 0;
+   }
+
+   fprintf(out, "profile accesses:%ld seconds:%.6f accesses_per_s:%.0f "
+           "timer_ticks:%llu\n", r->accesses, r->seconds,
+           r->seconds > 0 ? r->accesses / r->seconds : 0,
+           (unsigned long long)r->timer);
+   for(i=0; i<4; ++i) {
+      fprintf(out, "phase %-6s ticks:%llu share:%.1f%% ticks_per_access:%.1f\n",
+              names[i], (unsigned long long)ticks[i], 100.0 * ticks[i] / total,
+              (double)ticks[i] / accesses);
+   }
+
+   fprintf(out, "hw");
+   for(i=0; i<PROF_HW_COUNTERS; ++i) {
+      if(r->hw_available & (1 << i)) {
+         fprintf(out, " %s:%llu", hw_events[i].name,
+                 (unsigned long long)r->hw[i]);
+      } else {
+         fprintf(out, " %s:n/a", hw_events[i].name);
+      }
+   }
+   if((r->hw_available & 3) == 3 && r->hw[0]) {
+      fprintf(out, " ipc:%.2f", (double)r->hw[1] / r->hw[0]);
+   }
+   fprintf(out, "\n");
+   if(r->hw_error[0]) {
+      fprintf(out, "hw counters unavailable: %s\n", r->hw_error);
+   }
+}
+
+
+
+static void hw_open(int* fds, prof_report_t* report) {
+   int i;
+   for(i=0; i<PROF_HW_COUNTERS; ++i) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = hw_events[i].config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      if(fds[i] == -1) {
+         if(!report->hw_error[0]) {
+            snprintf(report->hw_error, sizeof(report->hw_error), "%s: %s",
+                     hw_events[i].name, strerror(errno));
+         }
+      } else {
+         report->hw_available |= 1 << i;
+      }
+   }
+}
+
+
+
+static uint64_t tick_overhead(void) {
+   uint64_t best = ~0ULL;
+   int i;
+   for(i=0; i<PROF_CALIBRATE; ++i) {
+      uint64_t t = prof_ticks();
+      t = prof_ticks() - t;
+      if(t < best) {
+         best = t;
+      }
+   }
+   return best;
+}
+
+
+
+static double wall_time(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
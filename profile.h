@@ -0,0 +1,69 @@
+/*
+ * profile.h - Profiling of the simulator itself (csim -P).
+ *
+ * A profiled run splits the time spent per access into three phases,
+ * timed with the time stamp counter:
+ *
+ *   decode  reading records from the trace (text parsing or the binary
+ *           mapping), timed per batch of records
+ *   lookup  the tag scan of the set (tag_lookup())
+ *   update  everything after the lookup: victim choice, the replacement
+ *           policy update and the counters
+ *   other   the rest: the loop, set index and tag computation, and the
+ *           timer reads themselves
+ *
+ * Only one batch of records in 16 has its lookup and update phases timed,
+ * and the totals are scaled up, so the timer reads barely slow the run.
+ * The two cache_access() phases are timed through cache_t.prof, which is
+ * NULL outside of profiled runs, so the only cost when profiling is off
+ * is a few predictable branches per access. A timer read perturbs the
+ * code around it, so the phase ticks are best compared with each other
+ * rather than added up to the total.
+ *
+ * Host hardware counters (cycles, instructions, last-level cache misses
+ * and branch misses) are read with perf_event_open(2) around the whole
+ * simulation. When the kernel refuses them (no PMU in a VM,
+ * perf_event_paranoid, seccomp) the report says so and carries on.
+ */
+#ifndef CSIM_PROFILE_H
+#define CSIM_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <x86intrin.h>
+#include "cache.h"
+#include "trace.h"
+
+/* Hardware counters read around the simulation */
+#define PROF_HW_COUNTERS 4
+
+typedef struct prof_report {
+   long accesses;          /* records simulated, 'I' included */
+   double seconds;         /* wall time of the simulation */
+   uint64_t total;         /* ticks of the simulation */
+   uint64_t decode;        /* ticks per phase, timer overhead removed */
+   uint64_t lookup;
+   uint64_t update;
+   uint64_t timer;         /* ticks of one timer read, as removed */
+
+   int hw_available;       /* bit i is set when hw[i] was counted */
+   char hw_error[64];      /* why the first missing counter is missing */
+   uint64_t hw[PROF_HW_COUNTERS];  /* cycles, instructions, LLC misses,
+                                      branch misses */
+} prof_report_t;
+
+/* Current time stamp counter value */
+static inline uint64_t prof_ticks(void) {
+   return __rdtsc();
+}
+
+/*
+ * prof_run - Simulates the rest of trace on c with every phase timed and
+ * the hardware counters running, filling report.
+ */
+void prof_run(trace_t* trace, cache_t* c, prof_report_t* report);
+
+/* Prints the phase breakdown, counters and throughput of a report */
+void prof_print(FILE* out, const prof_report_t* report);
+
+#endif /* CSIM_PROFILE_H */
@@ -0,0 +1,302 @@
+/*
+ * sample.c - Sampled simulation with confidence intervals (see sample.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sample.h"
+
+/* Two-sided 95% quantile of the normal distribution */
+#define SAMPLE_Z95 1.96
+
+/*
+ * Running sums of one quantity over the samples. cross sums its products
+ * with the accesses of each sample.
+ */
+typedef struct sample_sum {
+   double sum;
+   double sumsq;
+   double cross;
+} sample_sum_t;
+
+/* Indexes of sample_sum_t arrays: the counters, then the accesses */
+enum { SUM_HITS, SUM_MISSES, SUM_EVICTIONS, SUM_ACCESSES, NUM_SUMS };
+
+/*
+ * add_sample - Adds the hits, misses and evictions of one sample of
+ * accesses accesses to the sums
+ */
+static void add_sample(sample_sum_t* sums, const cache_stats_t* s,
+                       long accesses);
+
+/*
+ * scale - Ratio estimate of the population total of the counter y from
+ * n samples of a population of N, whose sampled accesses are in a and
+ * whose accesses total total. The 95% half-width is stored in ci; it is
+ * 0 when every unit was measured or fewer than two were.
+ */
+static double scale(const sample_sum_t* y, const sample_sum_t* a, long n,
+                    double N, long total, double* ci);
+
+/* Stores b - a in d */
+static void stats_sub(cache_stats_t* d, const cache_stats_t* b,
+                      const cache_stats_t* a);
+
+/* Runs the set sampling estimator */
+static int run_sets(trace_t* t, cache_t* c, const sample_cfg_t* cfg,
+                    sample_est_t* est);
+
+/* Runs the interval sampling estimator */
+static int run_intervals(trace_t* t, cache_t* c, const sample_cfg_t* cfg,
+                         sample_est_t* est);
+
+
+
+int sample_run(trace_t* t, int set_bits, int assoc, int block_bits,
+               const repl_policy_t* policy, const sample_cfg_t* cfg,
+               sample_est_t* est) {
+   cache_t c;
+   int ret;
+
+   if(!cfg->sets == !cfg->period) {
+      fprintf(stderr, "Choose either set or interval sampling\n");
+      return -1;
+   }
+   if(cfg->period && (cfg->window < 1 || cfg->warmup < 0 ||
+                      cfg->warmup + cfg->window > cfg->period)) {
+      fprintf(stderr, "Interval sampling needs 0 < window and "
+              "warmup + window <= period\n");
+      return -1;
+   }
+   if(cfg->sets < 0) {
+      fprintf(stderr, "Set sampling needs a positive number of sets\n");
+      return -1;
+   }
+   if(cache_init(&c, set_bits, assoc, block_bits, policy)) {
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+
+   memset(est, 0, sizeof(*est));
+   if(cfg->sets) {
+      ret = run_sets(t, &c, cfg, est);
+   } else {
+      ret = run_intervals(t, &c, cfg, est);
+   }
+   cache_free(&c);
+   return ret;
+}
+
+
+
+static void add_sample(sample_sum_t* sums, const cache_stats_t* s,
+                       long accesses) {
+   double y[NUM_SUMS];
+   int i;
+
+   y[SUM_HITS] = s->hits;
+   y[SUM_MISSES] = s->misses;
+   y[SUM_EVICTIONS] = s->evictions;
+   y[SUM_ACCESSES] = accesses;
+   for(i=0; i<NUM_SUMS; ++i) {
+      sums[i].sum += y[i];
+      sums[i].sumsq += y[i] * y[i];
+      sums[i].cross += y[i] * accesses;
+   }
+}
+
+
+
+static double scale(const sample_sum_t* y, const sample_sum_t* a, long n,
+                    double N, long total, double* ci) {
+   double ratio, var;
+   *ci = 0;
+   if(a->sum == 0) {
+      return 0;
+   }
+   // the counter per access of the samples, applied to every access
+   ratio = y->sum / a->sum;
+   if(n > 1 && n < N) {
+      // sample variance of the residuals y - ratio * a
+      var = (y->sumsq - 2 * ratio * y->cross + ratio * ratio * a->sumsq)
+            / (n - 1);
+      if(var > 0) { // scaled by the mean accesses of the samples
+         *ci = SAMPLE_Z95 * total / (a->sum / n) *
+               sqrt((1 - n / N) * var / n);
+      }
+   }
+   return ratio * total;
+}
+
+
+
+static void stats_sub(cache_stats_t* d, const cache_stats_t* b,
+                      const cache_stats_t* a) {
+   d->hits = b->hits - a->hits;
+   d->misses = b->misses - a->misses;
+   d->evictions = b->evictions - a->evictions;
+   d->dirty_evicted = b->dirty_evicted - a->dirty_evicted;
+   d->dirty_active = b->dirty_active - a->dirty_active;
+   d->double_accesses = b->double_accesses - a->double_accesses;
+}
+
+
+
+static int run_sets(trace_t* t, cache_t* c, const sample_cfg_t* cfg,
+                    sample_est_t* est) {
+   long num_sets = 1L << c->set_bits;
+   long n = cfg->sets < num_sets ? cfg->sets : num_sets;
+   long* slot = (long*)malloc(num_sets * sizeof(long));
+   long* perm = NULL;
+   cache_stats_t* per_set = (cache_stats_t*)calloc(n, sizeof(cache_stats_t));
+   long* accesses = (long*)calloc(n, sizeof(long));
+   sample_sum_t sums[NUM_SUMS];
+   uint64_t x = cfg->seed * 0x9e3779b97f4a7c15ULL + 1;
+   long total = 0, simulated = 0;
+   trace_rec_t rec;
+   long i;
+
+   if(slot && per_set && accesses) {
+      perm = (long*)malloc(n * sizeof(long));
+   }
+   if(!perm) {
+      free(slot);
+      free(per_set);
+      free(accesses);
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+
+   // picking n sets with a partial Fisher-Yates shuffle of the indexes
+   for(i=0; i<num_sets; ++i) {
+      slot[i] = i;
+   }
+   for(i=0; i<n; ++i) {
+      long j, tmp;
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      j = i + (long)(x % (uint64_t)(num_sets - i));
+      tmp = slot[i];
+      slot[i] = slot[j];
+      slot[j] = tmp;
+   }
+   // slot[set] becomes the sample the set belongs to, -1 if unsampled
+   for(i=0; i<n; ++i) {
+      perm[i] = slot[i];
+   }
+   for(i=0; i<num_sets; ++i) {
+      slot[i] = -1;
+   }
+   for(i=0; i<n; ++i) {
+      slot[perm[i]] = i;
+   }
+
+   while(trace_next(t, &rec)) {
+      cache_stats_t before, delta;
+      long s;
+      if(rec.op == 'I') {
+         continue;
+      }
+      total++;
+      s = slot[cache_set_index(c->set_bits, c->block_bits, rec.addr)];
+      if(s < 0) {
+         continue;
+      }
+      simulated++;
+      accesses[s]++;
+      before = c->stats;
+      cache_access(c, rec.op, rec.addr, NULL);
+      stats_sub(&delta, &c->stats, &before);
+      cache_stats_add(&per_set[s], &delta);
+   }
+
+   memset(sums, 0, sizeof(sums));
+   for(i=0; i<n; ++i) {
+      add_sample(sums, &per_set[i], accesses[i]);
+   }
+   free(slot);
+   free(perm);
+   free(per_set);
+   free(accesses);
+   if(total && !simulated) {
+      fprintf(stderr, "None of the %ld sampled sets was accessed, sample "
+              "more sets\n", n);
+      return -1;
+   }
+
+   est->samples = n;
+   est->population = num_sets;
+   est->fraction = total ? (double)simulated / total : 0;
+   est->stats.hits = scale(&sums[SUM_HITS], &sums[SUM_ACCESSES], n, num_sets,
+                           total, &est->hits_ci) + 0.5;
+   est->stats.misses = scale(&sums[SUM_MISSES], &sums[SUM_ACCESSES], n,
+                             num_sets, total, &est->misses_ci) + 0.5;
+   est->stats.evictions = scale(&sums[SUM_EVICTIONS], &sums[SUM_ACCESSES], n,
+                                num_sets, total, &est->evictions_ci) + 0.5;
+   if(simulated) {
+      est->stats.dirty_evicted = (double)c->stats.dirty_evicted * total /
+                                 simulated;
+      est->stats.double_accesses = (double)c->stats.double_accesses * total /
+                                   simulated;
+   }
+   est->stats.dirty_active = c->stats.dirty_active * num_sets / n;
+   return 0;
+}
+
+
+
+static int run_intervals(trace_t* t, cache_t* c, const sample_cfg_t* cfg,
+                         sample_est_t* est) {
+   cache_stats_t counted, start, delta;
+   sample_sum_t sums[NUM_SUMS];
+   long total = 0, simulated = 0, n = 0;
+   long window_end = cfg->warmup + cfg->window;
+   double N;
+   trace_rec_t rec;
+
+   memset(&counted, 0, sizeof(counted));
+   memset(&start, 0, sizeof(start));
+   memset(sums, 0, sizeof(sums));
+   while(trace_next(t, &rec)) {
+      long pos;
+      if(rec.op == 'I') {
+         continue;
+      }
+      pos = total++ % cfg->period;
+      if(pos >= window_end) { // skipped without simulation
+         continue;
+      }
+      if(pos == cfg->warmup) {
+         start = c->stats;
+      }
+      simulated++;
+      cache_access(c, rec.op, rec.addr, NULL);
+      if(pos == window_end - 1) { // a whole window was measured
+         stats_sub(&delta, &c->stats, &start);
+         cache_stats_add(&counted, &delta);
+         add_sample(sums, &delta, cfg->window);
+         n++;
+      }
+   }
+
+   if(n == 0) {
+      fprintf(stderr, "The trace is shorter than one sampling window\n");
+      return -1;
+   }
+   N = (double)total / cfg->window;
+   est->samples = n;
+   est->population = N;
+   est->fraction = (double)simulated / total;
+   est->stats.hits = scale(&sums[SUM_HITS], &sums[SUM_ACCESSES], n, N,
+                           total, &est->hits_ci) + 0.5;
+   est->stats.misses = scale(&sums[SUM_MISSES], &sums[SUM_ACCESSES], n, N,
+                             total, &est->misses_ci) + 0.5;
+   est->stats.evictions = scale(&sums[SUM_EVICTIONS], &sums[SUM_ACCESSES], n,
+                                N, total, &est->evictions_ci) + 0.5;
+   est->stats.dirty_evicted = counted.dirty_evicted * N / n;
+   est->stats.double_accesses = counted.double_accesses * N / n;
+   est->stats.dirty_active = c->stats.dirty_active; // the final state
+   return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * sample.h - Sampled simulation of traces too long to simulate exactly.
+ *
+ * Two estimators are supported, each scaling the counters it measures up
+ * to the whole trace and attaching a 95% confidence interval:
+ *
+ *   set sampling       only the accesses that map to a random subset of
+ *                      the sets are simulated. Sets are independent, so
+ *                      each sampled set is an exact sample of its own
+ *                      counters, and the totals are estimated from them.
+ *   interval sampling  the trace is cut into periods. Each period starts
+ *                      with warmup accesses that update the cache without
+ *                      being counted (functional warm-up), then window
+ *                      accesses that are counted; the rest of the period
+ *                      is skipped without simulation.
+ *
+ * Every access is counted, simulated or not, so both estimators are
+ * ratio estimators: a counter is its total over the samples divided by
+ * the accesses simulated in them, times the accesses of the whole trace.
+ * The intervals treat the sampled sets or windows as a simple random
+ * sample of all sets or windows: half-width 1.96 * X / m * sqrt((1 - n/N)
+ * s^2 / n) for n samples of a population of N, X accesses in all and m
+ * per sample on average, where s^2 is the sample variance of y - R a, y
+ * being a sample's counter, a its accesses and R the ratio. The interval assumes the sets (or windows) are homogeneous,
+ * i.e. that the sample represents the rest: a trace whose accesses
+ * crowd into a few sets, or whose phases are shorter than a period, can
+ * fall outside it however narrow it is.
+ */
+#ifndef CSIM_SAMPLE_H
+#define CSIM_SAMPLE_H
+
+#include "cache.h"
+#include "trace.h"
+
+typedef struct sample_cfg {
+   // set sampling, 0 = off
+   long sets;          /* number of sets simulated */
+   unsigned int seed;  /* picks the sets */
+
+   // interval sampling, 0 = off
+   long period;        /* accesses per period */
+   long window;        /* counted accesses per period */
+   long warmup;        /* uncounted accesses before each window */
+} sample_cfg_t;
+
+typedef struct sample_est {
+   cache_stats_t stats;    /* estimated counters of the whole trace */
+   double hits_ci;         /* 95% half-widths of hits, misses, evictions */
+   double misses_ci;
+   double evictions_ci;
+   long samples;           /* sets or windows measured */
+   double population;      /* sets or windows in the whole trace */
+   double fraction;        /* fraction of the accesses simulated */
+} sample_est_t;
+
+/*
+ * sample_run - Estimates the counters of a cache of 2^set_bits sets of
+ * assoc lines of 2^block_bits bytes over the rest of t, using exactly one
+ * of the two sampling modes of cfg. Returns 0 on success and -1 (with a
+ * message on stderr) on failure.
+ */
+int sample_run(trace_t* t, int set_bits, int assoc, int block_bits,
+               const repl_policy_t* policy, const sample_cfg_t* cfg,
+               sample_est_t* est);
+
+#endif /* CSIM_SAMPLE_H */
@@ -0,0 +1,117 @@
+#!/usr/bin/env python
+#
+# sample_report.py - Measures the accuracy of csim's sampled simulation
+#     (-S). Every bundled trace is simulated exactly and with set and
+#     interval sampling on a few (s,E,b) configurations; for each estimated
+#     counter the report gives the relative error, the 95% confidence
+#     interval csim reported and whether the exact value falls inside it.
+#
+#     make sample-report
+#
+import subprocess;
+import glob;
+import re;
+import sys;
+import optparse;
+
+CONFIGS = [(4, 2, 4), (5, 1, 5), (8, 4, 6), (10, 2, 6)]
+COUNTERS = ["hits", "misses", "evictions"]
+
+#
+# countAccesses - number of accesses csim simulates for a text trace
+#
+def countAccesses(path):
+    count = 0
+    for line in open(path):
+        if line[:1] == " " and line[1:2] in "LSM":
+            count += 1
+    return count
+
+#
+# runCsim - runs csim and returns a dict of every "name:value" it printed
+#
+def runCsim(path, s, E, b, extra):
+    args = ["./csim", "-s", str(s), "-E", str(E), "-b", str(b), "-t", path]
+    args += extra
+    p = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    stdout_data = p.communicate()[0].decode("utf-8")
+    if p.returncode != 0:
+        return None
+    result = {}
+    for line in stdout_data.splitlines():
+        prefix = "ci_" if line.startswith("ci95") else ""
+        for key, value in re.findall(r"(\w+):([\d.]+)", line):
+            result[prefix + key] = float(value)
+    return result
+
+#
+# main - Main function
+#
+def main():
+
+    # Parse the command line arguments
+    p = optparse.OptionParser()
+    p.add_option("-f", type="int", dest="set_fraction", default=4,
+                 help="set sampling simulates 1 set in this many");
+    p.add_option("-w", type="int", dest="windows", default=50,
+                 help="number of interval sampling windows per trace");
+    p.add_option("-d", type="int", dest="duty", default=10,
+                 help="interval sampling counts 1 access in this many");
+    p.add_option("-u", type="int", dest="warmup", default=4,
+                 help="interval sampling warms up for this many windows");
+    p.add_option("-m", type="int", dest="min_accesses", default=1000,
+                 help="traces with fewer accesses are skipped");
+    opts, args = p.parse_args()
+    traces = args or sorted(glob.glob("traces/*.trace"))
+
+    print("%-20s %-10s %-9s %-9s %10s %10s %8s %9s %s" %
+          ("trace", "s,E,b", "mode", "counter", "exact", "estimate",
+           "error", "ci95", "covered"))
+    covered = total = 0
+    errors = []
+    for path in traces:
+        accesses = countAccesses(path)
+        if accesses < opts.min_accesses:
+            print("%-20s skipped, %d accesses" % (path[7:], accesses))
+            continue
+        period = max(accesses // opts.windows, 1)
+        window = max(period // opts.duty, 1)
+        warmup = min(window * opts.warmup, period - window)
+        for (s, E, b) in CONFIGS:
+            exact = runCsim(path, s, E, b, [])
+            if exact is None:
+                print("%s failed" % path)
+                sys.exit(1)
+            modes = [("sets", ["-S", "sets=%d" %
+                               max((1 << s) // opts.set_fraction, 1)]),
+                     ("interval", ["-S", "period=%d,window=%d,warmup=%d" %
+                                   (period, window, warmup)])]
+            for (mode, extra) in modes:
+                est = runCsim(path, s, E, b, extra)
+                for counter in COUNTERS:
+                    if est is None:
+                        print("%-20s %-10s %-9s %-9s %10d %10s" %
+                              (path[7:], "%d,%d,%d" % (s, E, b), mode,
+                               counter, exact[counter], "n/a"))
+                        continue
+                    diff = est[counter] - exact[counter]
+                    error = diff / exact[counter] if exact[counter] else 0
+                    inside = abs(diff) <= est["ci_" + counter]
+                    total += 1
+                    covered += inside
+                    errors.append(abs(error))
+                    print("%-20s %-10s %-9s %-9s %10d %10d %+7.1f%% %9.0f %s" %
+                          (path[7:], "%d,%d,%d" % (s, E, b), mode, counter,
+                           exact[counter], est[counter], error * 100,
+                           est["ci_" + counter], "yes" if inside else "no"))
+
+    if total:
+        errors.sort()
+        print("\n%d of %d estimates within their 95%% interval, median "
+              "|error| %.1f%%, worst %.1f%%" %
+              (covered, total, errors[len(errors) // 2] * 100,
+               errors[-1] * 100))
+
+# execute main only if called as a script
+if __name__ == "__main__":
+    main()
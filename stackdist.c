@@ -0,0 +1,148 @@
+/*
+ * stackdist.c - One-pass multi-associativity LRU simulation (see stackdist.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "stackdist.h"
+#include "lookup.h"
+
+/* since_store value of a block that is clean in every cache */
+#define SD_CLEAN INT_MAX
+
+/* Applies one load (store = 0) or store (store = 1) to a set's stack */
+static void sd_reference(stackdist_t* sd, unsigned int set_index,
+                         uint64_t key, int store);
+
+
+
+int sd_init(stackdist_t* sd, int set_bits, int block_bits,
+            int min_assoc, int max_assoc) {
+   size_t lines = (size_t)max_assoc << set_bits;
+   sd->set_bits = set_bits;
+   sd->block_bits = block_bits;
+   sd->min_assoc = min_assoc;
+   sd->max_assoc = max_assoc;
+   sd->lookup = lookup_for(max_assoc);
+   sd->tags = (uint64_t*)calloc(lines, sizeof(uint64_t));
+   sd->since_store = (int*)calloc(lines, sizeof(int));
+   sd->depth = (int*)calloc((size_t)1 << set_bits, sizeof(int));
+   sd->counts = (cache_stats_t*)calloc(max_assoc - min_assoc + 1,
+                                       sizeof(cache_stats_t));
+   if(!(sd->tags && sd->since_store && sd->depth && sd->counts)) {
+      sd_free(sd);
+      return -1;
+   }
+   return 0;
+}
+
+
+
+void sd_access(stackdist_t* sd, char op, uint64_t addr) {
+   unsigned int set_index = (addr >> sd->block_bits) & ((1U << sd->set_bits)-1);
+   uint64_t key = (addr >> (sd->set_bits + sd->block_bits)) | LINE_VALID;
+
+   switch(op) {
+      case 'L':
+      sd_reference(sd, set_index, key, 0);
+      break;
+
+      case 'S':
+      sd_reference(sd, set_index, key, 1);
+      break;
+
+      case 'M':
+      sd_reference(sd, set_index, key, 0);
+      sd_reference(sd, set_index, key, 1);
+      break;
+   }
+}
+
+
+
+static void sd_reference(stackdist_t* sd, unsigned int set_index,
+                         uint64_t key, int store) {
+   uint64_t* tags = &sd->tags[set_index * sd->max_assoc];
+   int* since_store = &sd->since_store[set_index * sd->max_assoc];
+   int depth = sd->depth[set_index];
+   int block_size = 1 << sd->block_bits;
+   int cold;
+   int dist = sd->lookup(tags, sd->max_assoc, key, &cold);
+   int found = dist != -1;
+   int last = found ? dist : sd->max_assoc;
+   int reuse;
+   int e;
+
+   // misses in every cache too small to hold the block, E <= distance
+   for(e=sd->min_assoc; e<=sd->max_assoc && e<=last; ++e) {
+      cache_stats_t* c = &sd->counts[e - sd->min_assoc];
+      c->misses++;
+      if(depth >= e) { // the set is full, the block at E-1 is evicted
+         c->evictions++;
+         if(since_store[e-1] < e) {
+            c->dirty_evicted += block_size;
+         }
+      }
+   }
+   for(; e<=sd->max_assoc; ++e) {
+      sd->counts[e - sd->min_assoc].hits++;
+   }
+   if(dist == 0) { // hit on the most recently used block
+      for(e=sd->min_assoc; e<=sd->max_assoc; ++e) {
+         sd->counts[e - sd->min_assoc].double_accesses++;
+      }
+   }
+
+   // moving the block to the top of the stack
+   if(store) {
+      reuse = -1;
+   } else if(!found || since_store[dist] == SD_CLEAN) {
+      reuse = SD_CLEAN;
+   } else {
+      reuse = since_store[dist] > dist ? since_store[dist] : dist;
+   }
+   if(!found) {
+      last = depth < sd->max_assoc ? depth : sd->max_assoc - 1;
+      if(depth < sd->max_assoc) {
+         sd->depth[set_index]++;
+      }
+   }
+   memmove(&tags[1], &tags[0], last * sizeof(tags[0]));
+   memmove(&since_store[1], &since_store[0], last * sizeof(since_store[0]));
+   tags[0] = key;
+   since_store[0] = reuse;
+}
+
+
+
+void sd_finish(stackdist_t* sd) {
+   unsigned int set_index;
+   int block_size = 1 << sd->block_bits;
+   int pos, e;
+
+   for(set_index=0; set_index < 1U << sd->set_bits; ++set_index) {
+      int* since_store = &sd->since_store[set_index * sd->max_assoc];
+      for(pos=0; pos<sd->depth[set_index]; ++pos) {
+         // dirty in every cache that holds it (E > pos) and has not
+         // refilled it since the last store (E > since_store)
+         int lo = pos > since_store[pos] ? pos + 1 : since_store[pos] + 1;
+         if(since_store[pos] == SD_CLEAN) {
+            continue;
+         }
+         for(e = lo > sd->min_assoc ? lo : sd->min_assoc;
+             e<=sd->max_assoc; ++e) {
+            sd->counts[e - sd->min_assoc].dirty_active += block_size;
+         }
+      }
+   }
+}
+
+
+
+void sd_free(stackdist_t* sd) {
+   free(sd->tags);
+   free(sd->since_store);
+   free(sd->depth);
+   free(sd->counts);
+   memset(sd, 0, sizeof(*sd));
+}
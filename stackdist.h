@@ -0,0 +1,48 @@
+/*
+ * stackdist.h - One-pass LRU simulation of a range of associativities.
+ *
+ * LRU is a stack algorithm: an E-way set always holds the E most recently
+ * used blocks of that set. Keeping a per-set recency stack of depth Emax
+ * and recording the stack distance of every access therefore gives exact
+ * results for every E <= Emax from a single pass over the trace.
+ *
+ * Dirty state is tracked per stack entry as the largest stack distance
+ * seen since the block was last stored to. A block is dirty in an E-way
+ * cache exactly when that distance is below E, because any access with a
+ * larger distance refilled the block clean in that cache.
+ */
+#ifndef CSIM_STACKDIST_H
+#define CSIM_STACKDIST_H
+
+#include <stdint.h>
+#include "cache.h"
+
+typedef struct stackdist {
+   int set_bits;
+   int block_bits;
+   int min_assoc;
+   int max_assoc;
+   uint64_t* tags;       /* max_assoc per set, MRU first, tag|LINE_VALID */
+   int* since_store;     /* parallel to tags, see above */
+   int* depth;           /* number of blocks on each set's stack */
+   lookup_fn lookup;     /* lookup_for(max_assoc) */
+   cache_stats_t* counts; /* one per associativity, min_assoc first */
+} stackdist_t;
+
+/* Allocates the stacks for 2^set_bits sets. Returns 0 on success */
+int sd_init(stackdist_t* sd, int set_bits, int block_bits,
+            int min_assoc, int max_assoc);
+
+/* Simulates one access of type op ('L', 'S' or 'M') */
+void sd_access(stackdist_t* sd, char op, uint64_t addr);
+
+/*
+ * sd_finish - Fills in dirty_active for every associativity. Call once
+ * after the last access.
+ */
+void sd_finish(stackdist_t* sd);
+
+/* Frees the stacks and counters */
+void sd_free(stackdist_t* sd);
+
+#endif /* CSIM_STACKDIST_H */
@@ -0,0 +1,289 @@
+/*
+ * sweep.c - Multi-configuration simulation over one decoded trace (see
+ * sweep.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sweep.h"
+#include "stackdist.h"
+
+/* Records sweep_load() starts with, doubled as needed */
+#define LOAD_INIT_SIZE 65536
+
+/*
+ * A unit of work: rows first..first+count-1, which are either one row or
+ * a run of LRU rows sharing s and b, simulated in one stack pass
+ */
+typedef struct sweep_job {
+   int first;
+   int count;
+} sweep_job_t;
+
+typedef struct sweep_ctx {
+   const trace_rec_t* recs;
+   long n;
+   sweep_row_t* rows;
+   sweep_job_t* jobs;
+   int num_jobs;
+   int next_job;  /* claimed with __atomic_fetch_add */
+   int failed;
+} sweep_ctx_t;
+
+/* Worker thread body: runs jobs until none are left */
+static void* sweep_worker(void* arg);
+
+/* Simulates one row on a cache_t. Returns 0 on success */
+static int run_cache(sweep_ctx_t* ctx, sweep_row_t* row);
+
+/* Simulates a run of LRU rows in one stack pass. Returns 0 on success */
+static int run_stack(sweep_ctx_t* ctx, sweep_row_t* rows, int count);
+
+
+
+int sweep_parse_ints(const char* arg, int* vals, int max) {
+   int n = 0;
+   const char* p = arg;
+
+   for(;;) {
+      char* end;
+      long lo = strtol(p, &end, 10);
+      long hi = lo;
+      if(end == p) {
+         return -1;
+      }
+      p = end;
+      if(*p == '-') {
+         hi = strtol(p+1, &end, 10);
+         if(end == p+1 || hi < lo) {
+            return -1;
+         }
+         p = end;
+      }
+      for(; lo<=hi; ++lo) {
+         if(n == max) {
+            return -1;
+         }
+         vals[n++] = (int)lo;
+      }
+      if(*p == '\0') {
+         return n;
+      }
+      if(*p++ != ',') {
+         return -1;
+      }
+   }
+}
+
+
+
+int sweep_parse_policies(const char* arg, const repl_policy_t** policies,
+                         int max) {
+   char name[64];
+   int n = 0;
+
+   while(*arg) {
+      size_t len = strcspn(arg, ",");
+      if(len >= sizeof(name) || n == max) {
+         fprintf(stderr, "Bad policy list %s\n", arg);
+         return -1;
+      }
+      memcpy(name, arg, len);
+      name[len] = '\0';
+      if(!(policies[n++] = repl_policy_find(name))) {
+         fprintf(stderr, "Unknown replacement policy %s\n", name);
+         return -1;
+      }
+      arg += len + (arg[len] == ',');
+   }
+   return n;
+}
+
+
+
+long sweep_load(trace_t* trace, trace_rec_t** recs) {
+   size_t size = LOAD_INIT_SIZE;
+   long n = 0;
+   trace_rec_t rec;
+
+   if(!(*recs = (trace_rec_t*)malloc(size * sizeof(trace_rec_t)))) {
+      return -1;
+   }
+   while(trace_next(trace, &rec)) {
+      if(rec.op == 'I') {
+         continue;
+      }
+      if(n == size) {
+         trace_rec_t* grown = (trace_rec_t*)realloc(*recs, 2 * size *
+                                                    sizeof(trace_rec_t));
+         if(!grown) {
+            free(*recs);
+            return -1;
+         }
+         *recs = grown;
+         size *= 2;
+      }
+      (*recs)[n++] = rec;
+   }
+   return n;
+}
+
+
+
+int sweep_run(const trace_rec_t* recs, long n, sweep_row_t* rows,
+              int num_rows, int nthreads) {
+   sweep_ctx_t ctx;
+   pthread_t* threads;
+   int i, started = 0;
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.recs = recs;
+   ctx.n = n;
+   ctx.rows = rows;
+   ctx.jobs = (sweep_job_t*)malloc(num_rows * sizeof(sweep_job_t));
+   threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+   if(!ctx.jobs || !threads) {
+      free(ctx.jobs);
+      free(threads);
+      return -1;
+   }
+
+   // grouping adjacent LRU rows that only differ in E
+   for(i=0; i<num_rows; ++i) {
+      sweep_job_t* last = ctx.num_jobs ? &ctx.jobs[ctx.num_jobs-1] : NULL;
+      sweep_row_t* prev = i ? &rows[i-1] : NULL;
+      if(last && rows[i].policy == REPL_LRU && prev->policy == REPL_LRU &&
+         prev->set_bits == rows[i].set_bits &&
+         prev->block_bits == rows[i].block_bits) {
+         last->count++;
+      } else {
+         ctx.jobs[ctx.num_jobs].first = i;
+         ctx.jobs[ctx.num_jobs++].count = 1;
+      }
+   }
+
+   if(nthreads > ctx.num_jobs) {
+      nthreads = ctx.num_jobs;
+   }
+   for(i=0; i<nthreads; ++i) {
+      if(pthread_create(&threads[i], NULL, sweep_worker, &ctx)) {
+         ctx.failed = 1;
+         break;
+      }
+      started++;
+   }
+   for(i=0; i<started; ++i) {
+      pthread_join(threads[i], NULL);
+   }
+   free(threads);
+   free(ctx.jobs);
+   return ctx.failed ? -1 : 0;
+}
+
+
+
+void sweep_print(FILE* out, const sweep_row_t* rows, int num_rows,
+                 sweep_format_t format) {
+   int i;
+
+   if(format == SWEEP_CSV) {
+      fprintf(out, "s,E,b,policy,hits,misses,evictions,dirty_bytes_evicted,"
+              "dirty_bytes_active,double_refs,miss_rate\n");
+   } else {
+      fprintf(out, "[\n");
+   }
+   for(i=0; i<num_rows; ++i) {
+      const sweep_row_t* r = &rows[i];
+      const cache_stats_t* st = &r->stats;
+      long accesses = st->hits + st->misses;
+      double miss_rate = accesses ? (double)st->misses / accesses : 0;
+      if(format == SWEEP_CSV) {
+         fprintf(out, "%d,%d,%d,%s,%ld,%ld,%ld,%ld,%ld,%ld,%.6f\n",
+                 r->set_bits, r->assoc, r->block_bits, r->policy->name,
+                 st->hits, st->misses, st->evictions, st->dirty_evicted,
+                 st->dirty_active, st->double_accesses, miss_rate);
+      } else {
+         fprintf(out, "  {\"s\":%d, \"E\":%d, \"b\":%d, \"policy\":\"%s\", "
+                 "\"hits\":%ld, \"misses\":%ld, \"evictions\":%ld, "
+                 "\"dirty_bytes_evicted\":%ld, \"dirty_bytes_active\":%ld, "
+                 "\"double_refs\":%ld, \"miss_rate\":%.6f}%s\n",
+                 r->set_bits, r->assoc, r->block_bits, r->policy->name,
+                 st->hits, st->misses, st->evictions, st->dirty_evicted,
+                 st->dirty_active, st->double_accesses, miss_rate,
+                 i+1 < num_rows ? "," : "");
+      }
+   }
+   if(format == SWEEP_JSON) {
+      fprintf(out, "]\n");
+   }
+}
+
+
+
+static void* sweep_worker(void* arg) {
+   sweep_ctx_t* ctx = (sweep_ctx_t*)arg;
+   for(;;) {
+      int j = __atomic_fetch_add(&ctx->next_job, 1, __ATOMIC_RELAXED);
+      sweep_job_t* job;
+      int ret;
+      if(j >= ctx->num_jobs) {
+         return NULL;
+      }
+      job = &ctx->jobs[j];
+      if(job->count == 1) {
+         ret = run_cache(ctx, &ctx->rows[job->first]);
+      } else {
+         ret = run_stack(ctx, &ctx->rows[job->first], job->count);
+      }
+      if(ret) {
+         __atomic_store_n(&ctx->failed, 1, __ATOMIC_RELAXED);
+      }
+   }
+}
+
+
+
+static int run_cache(sweep_ctx_t* ctx, sweep_row_t* row) {
+   cache_t cache;
+   long i;
+
+   if(cache_init(&cache, row->set_bits, row->assoc, row->block_bits,
+                 row->policy)) {
+      return -1;
+   }
+   for(i=0; i<ctx->n; ++i) {
+      cache_access(&cache, ctx->recs[i].op, ctx->recs[i].addr, NULL);
+   }
+   row->stats = cache.stats;
+   cache_free(&cache);
+   return 0;
+}
+
+
+
+static int run_stack(sweep_ctx_t* ctx, sweep_row_t* rows, int count) {
+   stackdist_t sd;
+   int min_assoc = rows[0].assoc;
+   int max_assoc = rows[0].assoc;
+   long i;
+   int r;
+
+   for(r=1; r<count; ++r) {
+      if(rows[r].assoc < min_assoc) min_assoc = rows[r].assoc;
+      if(rows[r].assoc > max_assoc) max_assoc = rows[r].assoc;
+   }
+   if(sd_init(&sd, rows[0].set_bits, rows[0].block_bits, min_assoc,
+              max_assoc)) {
+      return -1;
+   }
+   for(i=0; i<ctx->n; ++i) {
+      sd_access(&sd, ctx->recs[i].op, ctx->recs[i].addr);
+   }
+   sd_finish(&sd);
+   for(r=0; r<count; ++r) {
+      rows[r].stats = sd.counts[rows[r].assoc - min_assoc];
+   }
+   sd_free(&sd);
+   return 0;
+}
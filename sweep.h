@@ -0,0 +1,64 @@
+/*
+ * sweep.h - Simulation of many cache configurations over one trace.
+ *
+ * The trace is decoded into memory once, and the configurations are
+ * shared out to a pool of threads that each replay it. Configurations
+ * that only differ in associativity under LRU are simulated together in
+ * one pass with LRU stack distances (see stackdist.h).
+ */
+#ifndef CSIM_SWEEP_H
+#define CSIM_SWEEP_H
+
+#include <stdio.h>
+#include "cache.h"
+#include "trace.h"
+
+/* Most values a list given to sweep_parse_ints() may expand to */
+#define SWEEP_MAX_VALUES 256
+
+typedef enum { SWEEP_CSV, SWEEP_JSON } sweep_format_t;
+
+/* One configuration and, once simulated, its counters */
+typedef struct sweep_row {
+   int set_bits;
+   int assoc;
+   int block_bits;
+   const repl_policy_t* policy;
+   cache_stats_t stats;
+} sweep_row_t;
+
+/*
+ * sweep_parse_ints - Parses a list of values and ranges such as "5",
+ * "1,2,4" or "1-4,8" into vals. Returns the number of values, or -1 if
+ * the list is malformed or longer than max.
+ */
+int sweep_parse_ints(const char* arg, int* vals, int max);
+
+/*
+ * sweep_parse_policies - Parses a comma separated list of replacement
+ * policy names. Returns the number of policies, or -1 with a message on
+ * stderr if a name is unknown or there are more than max.
+ */
+int sweep_parse_policies(const char* arg, const repl_policy_t** policies,
+                         int max);
+
+/*
+ * sweep_load - Reads the remaining L/S/M records of trace into a newly
+ * allocated array. Returns the number of records, or -1 on failure.
+ */
+long sweep_load(trace_t* trace, trace_rec_t** recs);
+
+/*
+ * sweep_run - Simulates the n records in recs on every row's
+ * configuration with nthreads threads, filling in the rows' counters.
+ * Rows of one LRU geometry differing only in E should be adjacent, so
+ * they share a pass. Returns 0 on success and -1 on failure.
+ */
+int sweep_run(const trace_rec_t* recs, long n, sweep_row_t* rows,
+              int num_rows, int nthreads);
+
+/* Prints the rows as CSV with a header line, or as a JSON array */
+void sweep_print(FILE* out, const sweep_row_t* rows, int num_rows,
+                 sweep_format_t format);
+
+#endif /* CSIM_SWEEP_H */
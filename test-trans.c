@@ -2,7 +2,12 @@
  * test-trans.c - Checks the correctness and performance of all of the
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
+ *
+ *     By default each function runs natively on matrices whose accesses
+ *     are captured straight into a simulator (see capture.h). -V traces
+ *     ./tracegen under valgrind instead, as the original lab did.
  */
+#define _POSIX_C_SOURCE 200809L /* for open_memstream() */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -11,13 +16,13 @@
 #include <signal.h>
 #include <getopt.h>
 #include <sys/types.h>
+#include <pthread.h>
 #include "cachelab.h"
+#include "libcsim.h"
+#include "capture.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
 
-/* Maximum array dimension */
-#define MAXN 256
-
 /* The description string for the transpose_submit() function that the
    student submits for credit */
 #define SUBMIT_DESCRIPTION "Transpose submission"
@@ -32,6 +37,8 @@ extern int func_counter;
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static int use_valgrind = 0; /* -V: trace tracegen under valgrind */
+static int num_workers = 0;  /* -j, defaults to the number of CPUs */
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -41,144 +48,254 @@ struct results {
 };
 static struct results results = {-1, 0, INT_MAX};
 
-/* 
- * eval_perf - Evaluate the performance of the registered transpose functions
+/* Scratch M x N matrices of one worker thread */
+typedef struct matrices {
+    size_t elems;
+    int* A;
+    int* B;
+    int* C;  /* the expected transpose */
+} matrices_t;
+
+/*
+ * One function's evaluation. Workers write each function's output to its
+ * own log, and the main thread prints the logs in function order.
  */
-void eval_perf(unsigned int s, unsigned int E, unsigned int b)
+typedef struct task {
+    int done;
+    char* log;
+    size_t log_len;
+} task_t;
+
+static task_t tasks[MAX_TRANS_FUNCS];
+static int next_task = 0;
+static pthread_mutex_t task_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t task_done = PTHREAD_COND_INITIALIZER;
+
+/* Cache geometry the functions are evaluated on */
+static unsigned int sim_s, sim_E, sim_b;
+
+/*
+ * validate - Checks that B holds the transpose of the M x N matrix A
+ */
+static int validate(int M, int N, int A[N][M], int B[M][N], int* C)
 {
-    int i,flag;
-    unsigned int len, hits, misses, evictions;
-    unsigned long long int marker_start, marker_end, addr;
-    char buf[1000], cmd[255];
-    char filename[128];
+    int i, j;
+
+    correctTrans(M, N, A, (int (*)[N])C);
+    for (i = 0; i < M; i++)
+        for (j = 0; j < N; j++)
+            if (B[i][j] != C[N*i+j])
+                return 0;
+    return 1;
+}
 
-    registerFunctions(); 
+/*
+ * capture_func - Runs transpose function i natively, simulating its
+ *     accesses to A and B on sim as they happen (see capture.h). Returns
+ *     0 if the function transposed correctly, 1 otherwise.
+ */
+static int capture_func(int i, csim_t* sim, matrices_t* m, FILE* out)
+{
+    initMatrix(M, N, (int (*)[M])m->A, (int (*)[N])m->B);
+
+    capture_start(sim);
+    capture_region(m->A, m->elems * sizeof(int), CAPTURE_A_BASE);
+    capture_region(m->B, m->elems * sizeof(int), CAPTURE_B_BASE_FOR(m->elems));
+    (*func_list[i].func_ptr)(M, N, (int (*)[M])m->A, (int (*)[N])m->B);
+    capture_stop();
 
-    /* Open the complete trace file */
-    FILE* full_trace_fp;  
-    FILE* part_trace_fp; 
+    if (!validate(M, N, (int (*)[M])m->A, (int (*)[N])m->B, m->C)) {
+        fprintf(out, "Validation failed on function %d!\n", i);
+        return 1;
+    }
+    return 0;
+}
 
-    /* Evaluate the performance of each registered transpose function */
+/*
+ * valgrind_func - Runs tracegen on transpose function i under valgrind
+ *     and pipes its trace straight into sim, which keeps only the accesses
+ *     between the MARKERS line tracegen prints and the end marker.
+ *     Returns tracegen's exit status, 0 if the function was correct.
+ */
+static int valgrind_func(int i, csim_t* sim)
+{
+    char cmd[255];
+    FILE* trace_fp;
+    trace_t trace;
+
+    sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d", M, N,i);
+    trace_fp = popen(cmd, "r");
+    assert(trace_fp);
+    if (trace_open_stream(&trace, trace_fp))
+        exit(1);
 
-    for (i=0; i<func_counter; i++) {
-        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
-            results.funcid = i; /* remember which function is the submission */
+    trace_set_markers(&trace, 0, 0, 1);
+    csim_run_trace(sim, &trace);
+    trace_close(&trace);
+    return WEXITSTATUS(pclose(trace_fp));
+}
 
+/*
+ * eval_func - Evaluate the performance of transpose function i, writing
+ *     the report to out
+ */
+static void eval_func(int i, matrices_t* m, FILE* out)
+{
+    int flag;
+    unsigned int hits, misses, evictions;
+    csim_t* sim;
+    csim_stats_t stats;
 
-        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
-        /* Use valgrind to generate the trace */
+    sim = csim_create(sim_s, sim_E, sim_b, NULL);
+    assert(sim);
 
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
-        flag=WEXITSTATUS(system(cmd));
+    fprintf(out, "\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
+    if (use_valgrind) {
+        flag = valgrind_func(i, sim);
         if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
-            continue;
+            fprintf(out, "Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
+            csim_destroy(sim);
+            return;
         }
+    } else if (capture_func(i, sim, m, out)) {
+        fprintf(out, "Skipping performance evaluation for this function.\n");
+        csim_destroy(sim);
+        return;
+    }
 
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
+    func_list[i].correct=1;
 
+    /* Save the correctness of the transpose submission */
+    if (results.funcid == i ) {
+        results.correct = 1;
+    }
 
-        func_list[i].correct=1;
+    fprintf(out, "Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", sim_s, sim_E, sim_b);
+    csim_stats(sim, &stats);
+    csim_destroy(sim);
+    hits = stats.hits;
+    misses = stats.misses;
+    evictions = stats.evictions;
+
+    /* 
+     * -3 because the way markers work now 3 misses are
+     * erroneously added. This should be fixed in a better way in
+     * the future. Captures only add the start marker's (see capture.h).
+     */
+    if (use_valgrind)
+        misses -= 3; //TODO FIXME
+    else
+        misses -= CAPTURE_FIXED_MISSES;
+
+    func_list[i].num_hits = hits;
+    func_list[i].num_misses = misses; 
+    func_list[i].num_evictions = evictions;
+    fprintf(out, "func %u (%s): hits:%u, misses:%u, evictions:%u\n",
+            i, func_list[i].description, hits, misses, evictions);
+
+    /* If it is transpose_submit(), record number of misses */
+    if (results.funcid == i) {
+        results.misses = misses;
+    }
+}
 
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i ) {
-            results.correct = 1;
-        }
+/*
+ * eval_worker - Worker thread: evaluates the next unclaimed function
+ *     until none are left
+ */
+static void* eval_worker(void* arg)
+{
+    matrices_t m;
+    task_t* t;
+    FILE* out;
+    int i;
+
+    m.elems = (size_t)M * N;
+    m.A = malloc(m.elems * sizeof(int));
+    m.B = malloc(m.elems * sizeof(int));
+    m.C = malloc(m.elems * sizeof(int));
+    if (!m.A || !m.B || !m.C) {
+        fprintf(stderr, "Unable to allocate %dx%d matrices\n", N, M);
+        exit(1);
+    }
+    for (;;) {
+        pthread_mutex_lock(&task_lock);
+        i = next_task++;
+        pthread_mutex_unlock(&task_lock);
+        if (i >= func_counter)
+            break;
 
-        full_trace_fp = fopen("trace.tmp", "r");
-        assert(full_trace_fp);
-
-
-        /* Filtered trace for each transpose function goes in a separate file */
-        sprintf(filename, "trace.f%d", i);
-        part_trace_fp = fopen(filename, "w");
-        assert(part_trace_fp);
-    
-        /* Locate trace corresponding to the trans function */
-        flag = 0;
-        while (fgets(buf, 1000, full_trace_fp) != NULL) {
-
-            /* We are only interested in memory access instructions */
-            if (buf[0]==' ' && buf[2]==' ' &&
-                (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
-                sscanf(buf+3, "%llx,%u", &addr, &len);
-        
-                /* If start marker found, set flag */
-                if (addr == marker_start)
-                    flag = 1;
-
-                /* Valgrind creates many spurious accesses to the
-                   stack that have nothing to do with the students
-                   code. At the moment, we are ignoring all stack
-                   accesses by using the simple filter of recording
-                   accesses to only the low 32-bit portion of the
-                   address space. At some point it would be nice to
-                   try to do more informed filtering so that would
-                   eliminate the valgrind stack references while
-                   include the student stack references. */
-                if (flag && addr < 0xffffffff) {
-                    fputs(buf, part_trace_fp);
-                }
-
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
-                    flag = 0;
-                    fclose(part_trace_fp);
-                    break;
-                }
-            }
-        }
-        fclose(full_trace_fp);
-
-        /* Run the reference simulator */
-        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
-    
-        /* Collect results from the reference simulator */
-        FILE* in_fp = fopen(".csim_results","r");
-        assert(in_fp);
-        fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
-        fclose(in_fp);
-
-	/* 
-	 * -3 because the way markers work now 3 misses are
-         * erroneously added. This should be fixed in a better way in
-	 * the future 
-	 */
-	misses -= 3; //TODO FIXME
-	
-        func_list[i].num_hits = hits;
-        func_list[i].num_misses = misses; 
-
-	
-        func_list[i].num_evictions = evictions;
-        printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
-               i, func_list[i].description, hits, misses, evictions);
-    
-        /* If it is transpose_submit(), record number of misses */
-        if (results.funcid == i) {
-            results.misses = misses;
+        t = &tasks[i];
+        out = open_memstream(&t->log, &t->log_len);
+        assert(out);
+        eval_func(i, &m, out);
+        fclose(out);
+
+        pthread_mutex_lock(&task_lock);
+        t->done = 1;
+        pthread_cond_broadcast(&task_done);
+        pthread_mutex_unlock(&task_lock);
+    }
+    free(m.A);
+    free(m.B);
+    free(m.C);
+    return NULL;
+}
+
+/* 
+ * eval_perf - Evaluate the performance of the registered transpose
+ *     functions on num_workers threads. Reports are printed in function
+ *     order as soon as each function and all those before it are done.
+ */
+void eval_perf(unsigned int s, unsigned int E, unsigned int b)
+{
+    pthread_t workers[MAX_TRANS_FUNCS];
+    int i;
+    int n;
+
+    registerFunctions(); 
+    sim_s = s;
+    sim_E = E;
+    sim_b = b;
+
+    /* remember which function is the submission */
+    for (i=0; i<func_counter; i++)
+        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
+            results.funcid = i;
+
+    n = num_workers < func_counter ? num_workers : func_counter;
+    for (i=0; i<n; i++) {
+        if (pthread_create(&workers[i], NULL, eval_worker, NULL)) {
+            fprintf(stderr, "Unable to start worker threads\n");
+            exit(1);
         }
     }
-  
+
+    for (i=0; i<func_counter; i++) {
+        pthread_mutex_lock(&task_lock);
+        while (!tasks[i].done)
+            pthread_cond_wait(&task_done, &task_lock);
+        pthread_mutex_unlock(&task_lock);
+        fwrite(tasks[i].log, 1, tasks[i].log_len, stdout);
+        fflush(stdout);
+        free(tasks[i].log);
+    }
+
+    for (i=0; i<n; i++)
+        pthread_join(workers[i], NULL);
 }
 
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-hV] [-j <threads>] -M <rows> -N <cols>\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
-    printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
-    printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
+    printf("  -M <rows>   Number of matrix rows\n");
+    printf("  -N <cols>   Number of  matrix columns\n");
+    printf("  -j <threads> Number of functions evaluated at once (default: CPUs)\n");
+    printf("  -V          Trace ./tracegen under valgrind instead of capturing\n");
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
 }
 
@@ -209,7 +326,7 @@ int main(int argc, char* argv[])
 {
     char c;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:j:hV")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -217,6 +334,12 @@ int main(int argc, char* argv[])
         case 'N':
             N = atoi(optarg);
             break;
+        case 'j':
+            num_workers = atoi(optarg);
+            break;
+        case 'V':
+            use_valgrind = 1;
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -232,12 +355,17 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
-    if (M > MAXN || N > MAXN) {
-        printf("Error: M or N exceeds %d\n", MAXN);
+    if (M < 0 || N < 0) {
+        printf("Error: M and N must be positive\n");
         usage(argv);
         exit(1);
     }
 
+    if (num_workers <= 0)
+        num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers <= 0)
+        num_workers = 1;
+
     /* Install SIGSEGV and SIGALRM handlers */
     if (signal(SIGSEGV, sigsegv_handler) == SIG_ERR) {
         fprintf(stderr, "Unable to install SIGALRM handler\n");
@@ -249,7 +377,7 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
-    /* Time out and give up after a while */
+    /* Time out and give up after a while, for all functions together */
     alarm(120);
 
     /* Check the performance of the student's transpose function */
@@ -0,0 +1,99 @@
+/*
+ * timing.c - Latency, miss parallelism and bandwidth model (see timing.h)
+ */
+#include <stdio.h>
+#include <string.h>
+#include "timing.h"
+
+/* Hit latencies of the levels not given, L1 first */
+static const int default_latency[] = {4, 12, 40, 80, 120, 160, 200, 240};
+
+
+
+int timing_init(timing_t* t, const timing_cfg_t* cfg, const hier_t* h) {
+   int last = h->num_levels - 1;
+   int i;
+
+   memset(t, 0, sizeof(*t));
+   if(cfg->num_latencies > h->num_levels) {
+      fprintf(stderr, "%d latencies given for %d levels\n",
+              cfg->num_latencies, h->num_levels);
+      return -1;
+   }
+   t->num_levels = h->num_levels;
+   for(i=0; i<h->num_levels; ++i) {
+      t->latency[i] = i < cfg->num_latencies ? cfg->latency[i]
+                                             : default_latency[i];
+   }
+   t->latency[h->num_levels] = cfg->mem_latency ? cfg->mem_latency : 200;
+   t->mlp = cfg->mlp ? cfg->mlp : 10;
+   t->ghz = cfg->ghz > 0 ? cfg->ghz : 3;
+   t->block_bytes = 1L << h->levels[last].block_bits;
+   t->transfer = cfg->bandwidth > 0 ? t->block_bytes / cfg->bandwidth : 0;
+
+   for(i=0; i<=h->num_levels; ++i) {
+      if(t->latency[i] < 1) {
+         fprintf(stderr, "Latencies must be positive\n");
+         return -1;
+      }
+   }
+   if(t->mlp < 1 || t->mlp > TIMING_MAX_MLP || cfg->bandwidth < 0) {
+      fprintf(stderr, "mlp must be 1 to %d and the bandwidth positive\n",
+              TIMING_MAX_MLP);
+      return -1;
+   }
+   return 0;
+}
+
+
+
+void timing_access(timing_t* t, int level, long mem_blocks) {
+   double issue = ++t->now;
+   double done;
+   int i, oldest = 0;
+
+   if(level > 0) {
+      // waiting for the oldest miss register if none is free
+      for(i=1; i<t->mlp; ++i) {
+         if(t->done[i] < t->done[oldest]) {
+            oldest = i;
+         }
+      }
+      if(t->done[oldest] > issue) {
+         issue = t->now = t->done[oldest];
+         t->stalls++;
+      }
+   }
+
+   done = issue + t->latency[level];
+   if(mem_blocks) {
+      double start = t->bus_free > issue ? t->bus_free : issue;
+      if(level == t->num_levels) {
+         done = start + t->latency[level];
+      }
+      t->bus_free = start + mem_blocks * t->transfer;
+      t->mem_blocks += mem_blocks;
+   }
+   if(level > 0) {
+      t->done[oldest] = done;
+   }
+
+   t->latency_sum += done - issue;
+   t->accesses++;
+   if(done > t->end) {
+      t->end = done;
+   }
+}
+
+
+
+void timing_print(FILE* out, const timing_t* t) {
+   double cycles = t->end > t->now ? t->end : t->now;
+   double bytes = (double)t->mem_blocks * t->block_bytes;
+   double per_cycle = cycles > 0 ? bytes / cycles : 0;
+
+   fprintf(out, "timing cycles:%.0f amat:%.2f stalls:%ld "
+           "bytes_per_cycle:%.3f gbps:%.3f\n", cycles,
+           t->accesses ? t->latency_sum / t->accesses : 0, t->stalls,
+           per_cycle, per_cycle * t->ghz);
+}
@@ -0,0 +1,73 @@
+/*
+ * timing.h - Latency and bandwidth estimate of a run over a hierarchy
+ * (csim -D).
+ *
+ * The model turns the level each access was served from into time:
+ *
+ *   - the core issues one access per cycle and never waits for a hit,
+ *     so a trace of L1 hits takes one cycle per access
+ *   - an access missing L1 holds one of mlp miss status registers until
+ *     its data arrives; with all of them busy the core stalls until the
+ *     oldest completes
+ *   - an access served by level i takes latency[i] cycles, and one served
+ *     by memory mem_latency cycles after memory starts it
+ *   - each block read from or written to memory holds the memory bus for
+ *     block bytes / bandwidth cycles, and memory starts a read only once
+ *     the bus is free
+ *
+ * Reported are the cycles until the last access completes, the average
+ * memory access time (issue to completion, queueing included) and the
+ * memory bandwidth achieved, per cycle and in GB/s at ghz.
+ */
+#ifndef CSIM_TIMING_H
+#define CSIM_TIMING_H
+
+#include "hier.h"
+
+/* Upper bound on the outstanding misses */
+#define TIMING_MAX_MLP 256
+
+typedef struct timing_cfg {
+   int num_latencies;                 /* levels given, the rest default */
+   int latency[HIER_MAX_LEVELS];      /* cycles of a hit per level */
+   int mem_latency;                   /* 0 = 200 */
+   double bandwidth;                  /* bytes per cycle, 0 = unlimited */
+   int mlp;                           /* outstanding misses, 0 = 10 */
+   double ghz;                        /* clock for the GB/s, 0 = 3 */
+} timing_cfg_t;
+
+typedef struct timing {
+   int num_levels;
+   int latency[HIER_MAX_LEVELS + 1];  /* memory last */
+   double transfer;                   /* bus cycles per block */
+   int mlp;
+   double ghz;
+   long block_bytes;
+
+   double now;                        /* issue cycle of the last access */
+   double bus_free;                   /* cycle the memory bus frees up */
+   double end;                        /* latest completion so far */
+   double done[TIMING_MAX_MLP];       /* completions of outstanding misses */
+   double latency_sum;                /* issue to completion, all accesses */
+   long accesses;
+   long stalls;                       /* accesses that waited for a register */
+   long mem_blocks;                   /* blocks read or written by memory */
+} timing_t;
+
+/*
+ * timing_init - Prepares a timing model of cfg for the hierarchy h.
+ * Returns 0 on success, and -1 with a message on stderr for a bad
+ * parameter.
+ */
+int timing_init(timing_t* t, const timing_cfg_t* cfg, const hier_t* h);
+
+/*
+ * timing_access - Accounts for one access served by level (num_levels for
+ * memory) that made memory read and write blocks in total
+ */
+void timing_access(timing_t* t, int level, long mem_blocks);
+
+/* Prints the cycles, AMAT and bandwidth */
+void timing_print(FILE* out, const timing_t* t);
+
+#endif /* CSIM_TIMING_H */
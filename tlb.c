@@ -0,0 +1,157 @@
+/*
+ * tlb.c - TLB levels and page walks (see tlb.h)
+ */
+#include <stdio.h>
+#include <string.h>
+#include "tlb.h"
+
+/* Virtual address bits translated by the page table entries of each level */
+static const int walk_shift[TLB_WALK_LEVELS] = {39, 30, 21, 12};
+
+/*
+ * cache_geometry - Converts entries and ways into set bits, 0 ways
+ * meaning fully associative. Returns -1 if the sets are not a power of 2
+ */
+static int cache_geometry(int entries, int* assoc);
+
+/* Walks the page table for addr, through the page walk cache */
+static void walk(tlb_t* t, uint64_t addr);
+
+
+
+int tlb_init(tlb_t* t, const tlb_cfg_t* cfg) {
+   static const int default_entries[] = {64, 1536};
+   static const int default_assoc[] = {4, 12};
+   int i;
+
+   memset(t, 0, sizeof(*t));
+   t->page_bits = cfg->page_bits ? cfg->page_bits : 12;
+   for(i=0; i<TLB_WALK_LEVELS && walk_shift[i] != t->page_bits; ++i);
+   if(i == TLB_WALK_LEVELS) {
+      fprintf(stderr, "Pages must be 4KB, 2MB or 1GB\n");
+      return -1;
+   }
+   t->walk_levels = i + 1;
+
+   for(i=0; i<(cfg->num_levels ? cfg->num_levels : 2); ++i) {
+      int entries = cfg->num_levels ? cfg->entries[i] : default_entries[i];
+      int assoc = cfg->num_levels ? cfg->assoc[i] : default_assoc[i];
+      int set_bits = cache_geometry(entries, &assoc);
+      if(set_bits < 0) {
+         fprintf(stderr, "TLB level %d: %d entries do not form a power of 2 "
+                 "of %d-way sets\n", i+1, entries, assoc);
+         tlb_free(t);
+         return -1;
+      }
+      if(cache_init(&t->levels[i], set_bits, assoc, t->page_bits,
+                    REPL_LRU)) {
+         fprintf(stderr, "Failed to allocate memory");
+         tlb_free(t);
+         return -1;
+      }
+      t->num_levels++;
+   }
+
+   if(cfg->pwc_entries < 0) {
+      fprintf(stderr, "The page walk cache needs a positive size\n");
+      tlb_free(t);
+      return -1;
+   }
+   if(cfg->pwc_entries) {
+      for(i=0; i<t->walk_levels - 1; ++i) {
+         if(cache_init(&t->pwc[i], 0, cfg->pwc_entries, walk_shift[i],
+                       REPL_LRU)) {
+            fprintf(stderr, "Failed to allocate memory");
+            tlb_free(t);
+            return -1;
+         }
+         t->pwc_levels++;
+      }
+   }
+   return 0;
+}
+
+
+
+int tlb_access(tlb_t* t, uint64_t addr) {
+   cache_result_t r;
+   int i;
+
+   // every level that misses is filled on the way
+   for(i=0; i<t->num_levels; ++i) {
+      cache_access(&t->levels[i], 'L', addr, &r);
+      if(r.hit) {
+         return i;
+      }
+   }
+   walk(t, addr);
+   return -1;
+}
+
+
+
+void tlb_free(tlb_t* t) {
+   int i;
+   for(i=0; i<t->num_levels; ++i) {
+      cache_free(&t->levels[i]);
+   }
+   for(i=0; i<t->pwc_levels; ++i) {
+      cache_free(&t->pwc[i]);
+   }
+   t->num_levels = 0;
+   t->pwc_levels = 0;
+}
+
+
+
+int tlb_parse_page(const char* name) {
+   if(!strcmp(name, "4k")) {
+      return 12;
+   } else if(!strcmp(name, "2m")) {
+      return 21;
+   } else if(!strcmp(name, "1g")) {
+      return 30;
+   }
+   return -1;
+}
+
+
+
+static int cache_geometry(int entries, int* assoc) {
+   int sets, set_bits = 0;
+   if(entries < 1 || *assoc < 0 || *assoc > entries) {
+      return -1;
+   }
+   if(!*assoc) {
+      *assoc = entries;
+   }
+   if(entries % *assoc) {
+      return -1;
+   }
+   for(sets = entries / *assoc; sets > 1; sets >>= 1) {
+      if(sets & 1) {
+         return -1;
+      }
+      set_bits++;
+   }
+   return set_bits;
+}
+
+
+
+static void walk(tlb_t* t, uint64_t addr) {
+   cache_result_t r;
+   int start = 0;
+   int i;
+
+   // the deepest cached entry gives the table to start from
+   for(i=0; i<t->pwc_levels; ++i) {
+      cache_access(&t->pwc[i], 'L', addr, &r);
+      if(r.hit) {
+         start = i + 1;
+      }
+   }
+   t->walks++;
+   t->pwc_hits += start > 0;
+   t->walk_refs += t->walk_levels - start;
+}
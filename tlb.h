@@ -0,0 +1,67 @@
+/*
+ * tlb.h - Multi-level TLB and page walk model run next to the data cache
+ * (csim -T).
+ *
+ * Every address of the trace is translated with a single page size, 4KB,
+ * 2MB or 1GB, as if all of memory were mapped with it. Each TLB level is
+ * a set-associative LRU cache_t of page translations: a lookup tries the
+ * levels in order and fills every level that missed (non-inclusive, like
+ * hier.h's nine). A miss in every level walks the x86-64 four-level page
+ * table, reading one entry per level down to the leaf: 4 for 4KB pages,
+ * 3 for 2MB and 2 for 1GB.
+ *
+ * The optional page walk cache holds the non-leaf entries a walk read
+ * (PML4, PDPT and PD entries, one fully-associative LRU cache_t of pwc
+ * entries for each level). A walk starts below the deepest entry it
+ * finds there, so walk_refs counts only the entries read from memory.
+ */
+#ifndef CSIM_TLB_H
+#define CSIM_TLB_H
+
+#include <stdint.h>
+#include "cache.h"
+
+#define TLB_MAX_LEVELS 3
+
+/* Levels of the page table, and so entries read by a 4KB page walk */
+#define TLB_WALK_LEVELS 4
+
+typedef struct tlb_cfg {
+   int num_levels;                 /* 0 = a 64 entry 4-way L1 and 1536
+                                      entry 12-way L2 */
+   int entries[TLB_MAX_LEVELS];
+   int assoc[TLB_MAX_LEVELS];      /* 0 = fully associative */
+   int page_bits;                  /* 12, 21 or 30, 0 = 12 */
+   int pwc_entries;                /* per non-leaf level, 0 = no cache */
+} tlb_cfg_t;
+
+typedef struct tlb {
+   int num_levels;
+   int page_bits;
+   cache_t levels[TLB_MAX_LEVELS];
+   int walk_levels;                /* entries read by an uncached walk */
+   int pwc_levels;                 /* 0 without a page walk cache */
+   cache_t pwc[TLB_WALK_LEVELS - 1];  /* PML4E, PDPTE, PDE */
+
+   long walks;                     /* translations missing every level */
+   long walk_refs;                 /* page table entries read by walks */
+   long pwc_hits;                  /* walks shortened by the walk cache */
+} tlb_t;
+
+/*
+ * tlb_init - Builds the TLB levels and page walk cache of cfg. Returns 0
+ * on success, and -1 with a message on stderr for a bad geometry or if
+ * memory could not be allocated.
+ */
+int tlb_init(tlb_t* t, const tlb_cfg_t* cfg);
+
+/* Translates addr. Returns the level it hit in, or -1 after a walk */
+int tlb_access(tlb_t* t, uint64_t addr);
+
+/* Frees every level and the walk cache */
+void tlb_free(tlb_t* t);
+
+/* Parses a page size "4k", "2m" or "1g" into bits. Returns -1 if unknown */
+int tlb_parse_page(const char* name);
+
+#endif /* CSIM_TLB_H */
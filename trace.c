@@ -0,0 +1,310 @@
+/*
+ * trace.c - Trace readers for the cache simulator (see trace.h)
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+/* Accesses at or above this address are valgrind's, see test-trans.c */
+#define TRACE_STACK_LIMIT 0xffffffffUL
+
+/* Maps a binary trace. Returns 0 on success, -1 on failure */
+static int open_binary(trace_t* t, int fd, const char* path);
+
+/* Reads the next raw record, ignoring markers. Returns 0 at the end */
+static int next_record(trace_t* t, trace_rec_t* rec);
+
+/*
+ * next_line - Returns the next line of a text trace, NUL terminated and
+ * without its newline, or NULL at the end of the input. The line stays
+ * valid until the next call.
+ */
+static char* next_line(trace_t* t);
+
+/*
+ * parse_line - Parses one lackey line such as " L 7ff000398,8" or
+ * "I  0400d7d4,8". Returns 1 if the line is an access, 0 otherwise.
+ * Exits if the thread id of a tagged line does not fit trace_rec_t.
+ */
+static int parse_line(trace_t* t, const char* line, trace_rec_t* rec);
+
+
+
+int trace_open(trace_t* t, const char* path) {
+   char magic[TRACE_MAGIC_LEN];
+   FILE* fp;
+
+   if(!strcmp(path, "-")) {
+      return trace_open_stream(t, stdin);
+   }
+
+   if(!(fp = fopen(path, "r"))) {
+      fprintf(stderr, "Could not open file %s\n", path);
+      return -1;
+   }
+
+   // binary traces start with the magic number, text traces never do
+   if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+      !memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN)) {
+      int ret;
+      memset(t, 0, sizeof(*t));
+      ret = open_binary(t, fileno(fp), path);
+      fclose(fp);
+      return ret;
+   }
+
+   rewind(fp);
+   if(trace_open_stream(t, fp)) {
+      fclose(fp);
+      return -1;
+   }
+   t->own_fp = 1;
+   return 0;
+}
+
+
+
+int trace_open_stream(trace_t* t, FILE* fp) {
+   memset(t, 0, sizeof(*t));
+   t->fp = fp;
+
+   // one byte more than the buffer so the last line can be terminated
+   if(!(t->buf = (char*)malloc(TRACE_BUF_SIZE + 1))) {
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+
+   // a pipe cannot be rewound, so the magic is read into the buffer
+   t->buf_len = fread(t->buf, 1, TRACE_MAGIC_LEN, fp);
+   if(t->buf_len == TRACE_MAGIC_LEN &&
+      !memcmp(t->buf, TRACE_MAGIC, TRACE_MAGIC_LEN)) {
+      fprintf(stderr, "Binary traces must be opened by name\n");
+      free(t->buf);
+      t->buf = NULL;
+      return -1;
+   }
+   return 0;
+}
+
+
+
+void trace_set_markers(trace_t* t, uint64_t start, uint64_t end, int in_band) {
+   t->filter = in_band ? 2 : 1;
+   t->in_region = 0;
+   t->marker_start = in_band ? 0 : start;
+   t->marker_end = in_band ? 0 : end;
+}
+
+
+
+int trace_read_markers(const char* path, uint64_t* start, uint64_t* end) {
+   unsigned long long s, e;
+   FILE* fp = fopen(path, "r");
+   int n;
+   if(!fp) {
+      fprintf(stderr, "Could not open file %s\n", path);
+      return -1;
+   }
+   n = fscanf(fp, "%llx %llx", &s, &e);
+   fclose(fp);
+   if(n != 2) {
+      fprintf(stderr, "Could not read markers from %s\n", path);
+      return -1;
+   }
+   *start = s;
+   *end = e;
+   return 0;
+}
+
+
+
+int trace_next_slow(trace_t* t, trace_rec_t* rec) {
+   while(next_record(t, rec)) {
+      int keep;
+      if(!t->filter) {
+         return 1;
+      }
+      if(rec->op == 'I' || (t->filter == 2 && !t->marker_start)) {
+         continue;
+      }
+
+      // same rules as the filter in test-trans.c
+      if(rec->addr == t->marker_start) {
+         t->in_region = 1;
+      }
+      keep = t->in_region && rec->addr < TRACE_STACK_LIMIT;
+      if(rec->addr == t->marker_end) {
+         t->in_region = 0;
+      }
+      if(keep) {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+
+
+void trace_close(trace_t* t) {
+   if(t->own_fp) {
+      fclose(t->fp);
+   }
+   if(t->map) {
+      munmap(t->map, t->map_len);
+   }
+   free(t->buf);
+   memset(t, 0, sizeof(*t));
+}
+
+
+
+static int next_record(trace_t* t, trace_rec_t* rec) {
+   char* line;
+   if(t->recs) {
+      if(t->pos == t->count) return 0;
+      *rec = t->recs[t->pos++];
+      return 1;
+   }
+
+   while((line = next_line(t))) {
+      if(parse_line(t, line, rec)) {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+
+
+static char* next_line(trace_t* t) {
+   for(;;) {
+      char* start = t->buf + t->buf_pos;
+      char* nl = (char*)memchr(start, '\n', t->buf_len - t->buf_pos);
+      size_t n;
+
+      if(nl && t->skipping) { // the end of an overlong line
+         t->buf_pos = nl - t->buf + 1;
+         t->skipping = 0;
+         continue;
+      }
+      if(nl) {
+         *nl = '\0';
+         t->buf_pos = nl - t->buf + 1;
+         return start;
+      }
+      if(t->eof) {
+         if(t->buf_pos == t->buf_len || t->skipping) {
+            return NULL;
+         }
+         // last line without a newline
+         t->buf[t->buf_len] = '\0';
+         t->buf_pos = t->buf_len;
+         return start;
+      }
+
+      // refilling, keeping the partial line at the front of the buffer
+      if(t->skipping || (t->buf_pos == 0 && t->buf_len == TRACE_BUF_SIZE)) {
+         t->skipping = 1;
+         t->buf_len = 0;
+      } else {
+         memmove(t->buf, start, t->buf_len - t->buf_pos);
+         t->buf_len -= t->buf_pos;
+      }
+      t->buf_pos = 0;
+      n = fread(t->buf + t->buf_len, 1, TRACE_BUF_SIZE - t->buf_len, t->fp);
+      if(n == 0) {
+         t->eof = 1;
+      }
+      t->buf_len += n;
+   }
+}
+
+
+
+static int parse_line(trace_t* t, const char* line, trace_rec_t* rec) {
+   const char* p = line;
+   char* end;
+   unsigned long addr, size, thread = 0;
+
+   while(*p == ' ') p++;
+   if(t->filter == 2 && !strncmp(p, TRACE_MARKER_LINE " ",
+                                 sizeof(TRACE_MARKER_LINE))) {
+      unsigned long long s, e;
+      if(sscanf(p + sizeof(TRACE_MARKER_LINE), "%llx %llx", &s, &e) == 2) {
+         t->marker_start = s;
+         t->marker_end = e;
+      }
+      return 0;
+   }
+
+   if(!(*p == 'I' || *p == 'L' || *p == 'S' || *p == 'M') || p[1] != ' ') {
+      return 0;
+   }
+   rec->op = *p++;
+   while(*p == ' ') p++;
+
+   addr = strtoul(p, &end, 16);
+   if(end == p || *end != ',') {
+      return 0;
+   }
+   p = end + 1;
+   size = strtoul(p, &end, 10);
+   if(end == p) {
+      return 0;
+   }
+
+   if(*end == ' ') {
+      while(*end == ' ') end++;
+      thread = *end == '-' ? TRACE_MAX_THREADS : strtoul(end, NULL, 10);
+      if(thread >= TRACE_MAX_THREADS) {
+         fprintf(stderr, "Thread id out of range, at most %d, in trace line "
+                 "%s\n", TRACE_MAX_THREADS - 1, line);
+         exit(1);
+      }
+   }
+
+   rec->addr = addr;
+   rec->size = size;
+   rec->thread = thread;
+   return 1;
+}
+
+
+
+static int open_binary(trace_t* t, int fd, const char* path) {
+   struct stat st;
+   const trace_header_t* hdr;
+
+   if(fstat(fd, &st) || st.st_size < (off_t)sizeof(trace_header_t)) {
+      fprintf(stderr, "Truncated binary trace %s\n", path);
+      return -1;
+   }
+
+   t->map_len = st.st_size;
+   t->map = mmap(NULL, t->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+   if(t->map == MAP_FAILED) {
+      t->map = NULL;
+      fprintf(stderr, "Could not map file %s\n", path);
+      return -1;
+   }
+   // records are read front to back exactly once
+   posix_madvise(t->map, t->map_len, POSIX_MADV_SEQUENTIAL);
+
+   hdr = (const trace_header_t*)t->map;
+   t->count = hdr->count;
+   t->recs = (const trace_rec_t*)(hdr + 1);
+   if(t->count > (t->map_len - sizeof(*hdr)) / sizeof(trace_rec_t)) {
+      fprintf(stderr, "Truncated binary trace %s\n", path);
+      munmap(t->map, t->map_len);
+      t->map = NULL;
+      t->recs = NULL;
+      return -1;
+   }
+   return 0;
+}
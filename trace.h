@@ -0,0 +1,132 @@
+/*
+ * trace.h - Readers for memory traces consumed by the cache simulator.
+ *
+ * Two formats are supported:
+ *   - the valgrind lackey text format (" L 7ff000398,8"), kept for
+ *     compatibility with the handout traces, and
+ *   - a compact fixed-width binary format (see tracebin.c) that is
+ *     mmapped and walked record by record with no parsing at all.
+ *
+ * trace_open() detects the format from the file's magic number, so any
+ * tool that accepts a trace accepts either kind. The path "-" reads a text
+ * trace from stdin a buffer at a time, so valgrind can be piped straight
+ * into the simulator. Text lines that are not accesses, such as lackey's
+ * "==pid==" banners or program output, are skipped. An access whose
+ * thread id is TRACE_MAX_THREADS or more is an error, and exits.
+ *
+ * A trace can be restricted to the accesses between a start and an end
+ * marker address, the way test-trans filters tracegen's output (see
+ * trace_set_markers()).
+ */
+#ifndef CSIM_TRACE_H
+#define CSIM_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_MAGIC "CSIMTRC1"
+#define TRACE_MAGIC_LEN 8
+
+/* Thread ids of a tagged trace must be below this, see trace_rec_t */
+#define TRACE_MAX_THREADS 256
+
+/* One memory access. Binary traces store these back to back */
+typedef struct trace_rec {
+   uint64_t addr;   /* address of the access */
+   uint32_t size;   /* number of bytes accessed */
+   char op;         /* 'L', 'S', 'M' or 'I' */
+   unsigned char thread;  /* thread of a tagged trace, else 0 */
+   char pad[2];     /* always zero in binary traces */
+} trace_rec_t;
+
+/* Header at the start of every binary trace */
+typedef struct trace_header {
+   char magic[TRACE_MAGIC_LEN];
+   uint64_t count;  /* number of records following the header */
+} trace_header_t;
+
+/* Size of the read buffer of text traces, and so the longest line */
+#define TRACE_BUF_SIZE 65536
+
+/*
+ * Line tracegen prints to stdout before running the transpose functions,
+ * so that a trace piped from valgrind carries its own marker addresses
+ */
+#define TRACE_MARKER_LINE "MARKERS"
+
+/* An open trace, text or binary */
+typedef struct trace {
+   FILE* fp;                 /* text traces only */
+   int own_fp;               /* trace_close() closes fp */
+   char* buf;                /* text read buffer, TRACE_BUF_SIZE bytes */
+   size_t buf_pos;           /* start of the unparsed text */
+   size_t buf_len;           /* end of the valid text */
+   int eof;                  /* fp has no more data */
+   int skipping;             /* dropping the rest of an overlong line */
+
+   const trace_rec_t* recs;  /* binary traces only, points into the map */
+   size_t pos;               /* next record to return (binary) */
+   size_t count;             /* number of records (binary) */
+   void* map;                /* mmapped file (binary) */
+   size_t map_len;
+
+   // marker filtering, see trace_set_markers()
+   int filter;               /* 0 = off, 1 = file markers, 2 = in-band */
+   int in_region;            /* between a start and an end marker */
+   uint64_t marker_start;
+   uint64_t marker_end;
+} trace_t;
+
+/*
+ * trace_open - Opens the trace at path. Returns 0 on success and -1 (with
+ * a message on stderr) on failure.
+ */
+int trace_open(trace_t* t, const char* path);
+
+/*
+ * trace_open_stream - Reads a text trace from an already open stream,
+ * such as a pipe from valgrind. The stream is left open by trace_close().
+ * Returns 0 on success and -1 on failure.
+ */
+int trace_open_stream(trace_t* t, FILE* fp);
+
+/*
+ * trace_set_markers - Restricts the trace to the L/S/M accesses from each
+ * access to start through the next access to end, dropping accesses at or
+ * above 4GB (valgrind's own stack) as test-trans does. With in_band set,
+ * start and end are ignored and the addresses are taken from the
+ * TRACE_MARKER_LINE line of a text trace instead.
+ */
+void trace_set_markers(trace_t* t, uint64_t start, uint64_t end, int in_band);
+
+/*
+ * trace_read_markers - Reads "start end" marker addresses, in hex, from a
+ * file. Returns 0 on success and -1 on failure.
+ */
+int trace_read_markers(const char* path, uint64_t* start, uint64_t* end);
+
+/*
+ * trace_next_slow - Reads the next record of a text trace, or of any trace
+ * with marker filtering. Returns 1 on success, 0 at the end of the trace.
+ */
+int trace_next_slow(trace_t* t, trace_rec_t* rec);
+
+/* Releases the resources held by an open trace */
+void trace_close(trace_t* t);
+
+/*
+ * trace_next - Stores the next record in rec. Returns 1 on success and 0
+ * at the end of the trace. Binary records are returned straight from the
+ * mapping, so this is a bounds check and a copy.
+ */
+static inline int trace_next(trace_t* t, trace_rec_t* rec) {
+   if(t->recs && !t->filter) {
+      if(t->pos == t->count) return 0;
+      *rec = t->recs[t->pos++];
+      return 1;
+   }
+   return trace_next_slow(t, rec);
+}
+
+#endif /* CSIM_TRACE_H */
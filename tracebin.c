@@ -0,0 +1,59 @@
+/*
+ * tracebin.c - Converts a valgrind lackey text trace into the binary
+ * trace format read by csim (see trace.h).
+ *
+ * The binary file is a trace_header_t followed by one fixed-width
+ * trace_rec_t per access. csim mmaps it and walks the records directly,
+ * which avoids the per-line fscanf() cost of text traces. Use it for any
+ * trace that will be simulated more than once:
+ *
+ *     linux> ./tracebin traces/long.trace long.bin
+ *     linux> ./csim -s 5 -E 1 -b 5 -t long.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+int main(int argc, char* argv[])
+{
+   trace_t in;
+   trace_rec_t rec;
+   trace_header_t hdr;
+   FILE* out;
+
+   if(argc != 3) {
+      fprintf(stderr, "Usage: %s <text trace> <binary trace>\n", argv[0]);
+      exit(1);
+   }
+
+   if(trace_open(&in, argv[1])) {
+      exit(1);
+   }
+   if(!(out = fopen(argv[2], "wb"))) {
+      fprintf(stderr, "Could not open file %s\n", argv[2]);
+      exit(1);
+   }
+
+   // the count is filled in once all records are written
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+   fwrite(&hdr, sizeof(hdr), 1, out);
+
+   memset(&rec, 0, sizeof(rec));
+   while(trace_next(&in, &rec)) {
+      if(fwrite(&rec, sizeof(rec), 1, out) != 1) {
+         fprintf(stderr, "Error writing %s\n", argv[2]);
+         exit(1);
+      }
+      hdr.count++;
+   }
+   trace_close(&in);
+
+   if(fseek(out, 0, SEEK_SET) || fwrite(&hdr, sizeof(hdr), 1, out) != 1 ||
+      fclose(out)) {
+      fprintf(stderr, "Error writing %s\n", argv[2]);
+      exit(1);
+   }
+   return 0;
+}
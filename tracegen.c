@@ -4,15 +4,25 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are printed to stdout, so that a trace piped from valgrind
+ * carries them in-band (csim -m -). Nothing is written to disk, so any
+ * number of tracegen processes can run at once.
+ *
+ * Matrices up to 256x256 live in static arrays. Larger ones are mapped
+ * below 4GB with the same page offset, B right after A, since the trace
+ * reader drops higher addresses as stack accesses.
  */
-
+#define _GNU_SOURCE /* for MAP_32BIT */
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <stdint.h>
+#include <sys/mman.h>
 #include "cachelab.h"
+#include "trace.h"
+#include "capture.h"
 #include <string.h>
 
 /* External variables declared in cachelab.c */
@@ -22,31 +32,74 @@ extern int func_counter;
 /* External function from trans.c */
 extern void registerFunctions();
 
-/* Markers used to bound trace regions of interest */
-volatile char MARKER_START, MARKER_END;
+/*
+ * The markers, A and B at the page offsets capture.h gives them, so that
+ * captures and traces see the same sets however the binary is laid out
+ */
+#define PAGE_OFFSET(addr) ((addr) & 0xfff)
+static char LAYOUT[PAGE_OFFSET(CAPTURE_A_BASE) + 2*256*256*sizeof(int)]
+    __attribute__((aligned(4096)));
 
-static int A_TEMP[256][256];
-static int A[256][256];
-static int B[256][256];
+/* Markers used to bound trace regions of interest */
+#define MARKER_START \
+    (*(volatile char*)(LAYOUT + PAGE_OFFSET(CAPTURE_MARKER_START)))
+#define MARKER_END \
+    (*(volatile char*)(LAYOUT + PAGE_OFFSET(CAPTURE_MARKER_END)))
+
+static int A_TEMP_STATIC[256][256];
+static int* A_TEMP;
+static int* A;
+static int* B;
 static int M;
 static int N;
 
 
 int validate(int fn,int M, int N, int A[N][M], int B[M][N]) {
-    int C[M][N];
-    memset(C,0,sizeof(C));
+    int (*C)[N] = calloc((size_t)M*N, sizeof(int));
+    assert(C);
     correctTrans(M,N,A,C);
     for(int i=0;i<M;i++) {
         for(int j=0;j<N;j++) {
             if(B[i][j]!=C[i][j]) {
                 printf("Validation failed on function %d! Expected %d but got %d at B[%d][%d]\n",fn,C[i][j],B[i][j],i,j);
+                free(C);
                 return 0;
             }
         }
     }
+    free(C);
     return 1;
 }
 
+/*
+ * alloc_matrices - Points A, B and A_TEMP at the static arrays, or at a mapping
+ * laid out like them for matrices over 256x256 (see capture.h)
+ */
+void alloc_matrices(size_t elems) {
+    size_t offset = PAGE_OFFSET(CAPTURE_A_BASE);
+    size_t len;
+    char* map;
+
+    if (elems <= 256*256) {
+        A_TEMP = &A_TEMP_STATIC[0][0];
+        A = (int*)(LAYOUT + offset);
+        B = A + 256*256;
+        return;
+    }
+    A_TEMP = malloc(elems*sizeof(int));
+    assert(A_TEMP);
+    len = offset + 2*elems*sizeof(int);
+    map = mmap(NULL, len, PROT_READ|PROT_WRITE,
+               MAP_PRIVATE|MAP_ANONYMOUS|MAP_32BIT, -1, 0);
+    if (map == MAP_FAILED) {
+        /* anywhere else, the trace would silently lose the accesses */
+        fprintf(stderr, "Unable to map %dx%d matrices below 4GB\n", N, M);
+        exit(1);
+    }
+    A = (int*)(map + offset);
+    B = A + elems;
+}
+
 int main(int argc, char* argv[]){
     int i;
 
@@ -75,33 +128,32 @@ int main(int argc, char* argv[]){
     registerFunctions();
 
     /* Fill A with data */
-    initMatrix(M,N, A, B);
+    alloc_matrices((size_t)M*N);
+    initMatrix(M,N, (int (*)[M])A, (int (*)[N])B);
     
     /* Store initial A values in A_TEMP for correctness check */
-    memcpy(A_TEMP, A, M*N*sizeof(A[0][0]));
+    memcpy(A_TEMP, A, (size_t)M*N*sizeof(A[0]));
 
     /* Record marker addresses */
-    FILE* marker_fp = fopen(".marker","w");
-    assert(marker_fp);
-    fprintf(marker_fp, "%llx %llx", 
-            (unsigned long long int) &MARKER_START,
-            (unsigned long long int) &MARKER_END );
-    fclose(marker_fp);
+    printf(TRACE_MARKER_LINE " %llx %llx\n",
+           (unsigned long long int) &MARKER_START,
+           (unsigned long long int) &MARKER_END );
+    fflush(stdout);
 
     if (-1==selectedFunc) {
         /* Invoke registered transpose functions */
         for (i=0; i < func_counter; i++) {
             MARKER_START = 33;
-            (*func_list[i].func_ptr)(M, N, A, B);
+            (*func_list[i].func_ptr)(M, N, (int (*)[M])A, (int (*)[N])B);
             MARKER_END = 34;
-            if (!validate(i,M,N,A_TEMP,B))
+            if (!validate(i,M,N,(int (*)[M])A_TEMP,(int (*)[N])B))
                 return i+1;
         }
     } else {
         MARKER_START = 33;
-        (*func_list[selectedFunc].func_ptr)(M, N, A, B);
+        (*func_list[selectedFunc].func_ptr)(M, N, (int (*)[M])A, (int (*)[N])B);
         MARKER_END = 34;
-        if (!validate(selectedFunc,M,N,A_TEMP,B))
+        if (!validate(selectedFunc,M,N,(int (*)[M])A_TEMP,(int (*)[N])B))
             return selectedFunc+1;
 
     }
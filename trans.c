@@ -8,14 +8,23 @@
  * on a 1KB direct mapped cache with a block size of 32 bytes.
  */
 #include <stdio.h>
+#include <string.h>
 #include "cachelab.h"
+#include "tune.h"
+#include "tune_table.h"
+#include "trans_simd.h"
 #define BLOCK_SIZE 8
-#define ALT_BLOCK 23
 
 int is_transpose(int M, int N, int A[N][M], int B[M][N]);
 
 void sub_trans(int m, int n, int M, int N, int* A, int* B);
 void sub_trans8(int i, int j, int M, int N, int A[N][M], int B[M][N]);
+void sub_tile(int ti, int tj, int n, int m, int M, int N, int A[N][M],
+              int B[M][N], const trans_tile_t* cfg);
+void sub_recursive(int i, int j, int n, int m, int M, int N, int A[N][M],
+                   int B[M][N]);
+void sub_recursive_elems(int i, int j, int n, int m, int M, int N,
+                         size_t size, const char* A, char* B);
 
 /*
  * transpose_submit - This is the solution transpose function that you
@@ -27,34 +36,16 @@ void sub_trans8(int i, int j, int M, int N, int A[N][M], int B[M][N]);
 char transpose_submit_desc[] = "Transpose submission";
 void transpose_submit(int M, int N, int A[N][M], int B[M][N])
 {
-   int i,j;
+   const trans_tile_t* tuned;
 
-   if (M==64 && N==64) {
-      for (i=0; i<N; i+=BLOCK_SIZE) {
-         for (j=0; j<M; j+=BLOCK_SIZE) {
-            sub_trans8(i,j, M, N, A, B);
-         }
-      }
-      return;
-   } else if (M==61 && N==67) {
-      // block size of 23 from experimentation
-      for (i=0; i<N; i+=ALT_BLOCK) {
-         for (j=0; j<M; j+=ALT_BLOCK) {
-            sub_trans(j+ALT_BLOCK <= M ? ALT_BLOCK: M % ALT_BLOCK,
-                         i+ALT_BLOCK <= N ? ALT_BLOCK: N % ALT_BLOCK,
-                         M, N, &A[i][j], &B[j][i]);
-         }
-      }
+   // shapes in tune_table.h use the tiles the tuner picked for them
+   if ((tuned = trans_tile_find(M, N))) {
+      trans_tiled(M, N, A, B, tuned);
       return;
    }
 
-   for (i=0; i<N; i+=BLOCK_SIZE) {
-      for (j=0; j<M; j+=BLOCK_SIZE) {
-         sub_trans(j+BLOCK_SIZE <= M ? BLOCK_SIZE: M % BLOCK_SIZE,
-                      i+BLOCK_SIZE <= N ? BLOCK_SIZE: N % BLOCK_SIZE,
-                      M, N, &A[i][j], &B[j][i]);
-      }
-   }
+   // any other shape, of any size
+   sub_recursive(0, 0, N, M, M, N, A, B);
 }
 
 /*
@@ -90,7 +81,7 @@ void trans(int M, int N, int A[N][M], int B[M][N])
  */
 void sub_trans(int m, int n, int M, int N, int* A, int* B) {
    int i, j;
-   int d,tmp; // variables to store the diagonals
+   int d=0, tmp=0; // variables to store the diagonals
    for(i=0; i<n; ++i) {
       for(j=0; j<m; ++j) {
          if(i!=j)
@@ -173,6 +164,179 @@ void sub_trans8(int i, int j, int M, int N, int A[N][M], int B[M][N]) {
    }
 }
 
+/*
+ * trans_tiled - Transposes A one tile of cfg->tile_rows x cfg->tile_cols
+ *     at a time, the tiles taken along the rows of A, or down its columns
+ *     if cfg->col_major is set. See tune.h.
+ */
+void trans_tiled(int M, int N, int A[N][M], int B[M][N],
+                 const trans_tile_t* cfg)
+{
+   int rows = cfg->tile_rows;
+   int cols = cfg->tile_cols;
+   int down = (N + rows - 1) / rows; // tiles down a column of A
+   int across = (M + cols - 1) / cols; // tiles along a row of A
+   int t, ti, tj;
+
+   for(t=0; t<down*across; ++t) {
+      ti = (cfg->col_major ? t % down : t / across) * rows;
+      tj = (cfg->col_major ? t / down : t % across) * cols;
+      if(cfg->trans8 && rows == 8 && cols == 8 && ti+8 <= N && tj+8 <= M) {
+         sub_trans8(ti, tj, M, N, A, B);
+         continue;
+      }
+      sub_tile(ti, tj, ti+rows <= N ? rows : N-ti, tj+cols <= M ? cols : M-tj,
+               M, N, A, B, cfg);
+   }
+}
+
+/*
+ * sub_tile - Transposes the n x m tile of A at row ti and column tj.
+ *     With cfg->defer_diag, the element on the tile's diagonal is held
+ *     back and stored after the rest of its row (or column), as in
+ *     sub_trans.
+ */
+void sub_tile(int ti, int tj, int n, int m, int M, int N, int A[N][M],
+              int B[M][N], const trans_tile_t* cfg)
+{
+   int i, j;
+   int d, tmp; // the deferred diagonal element, d = -1 if none
+   int outer = cfg->col_inner ? m : n;
+   int inner = cfg->col_inner ? n : m;
+
+   for(i=0; i<outer; ++i) {
+      d = -1;
+      for(j=0; j<inner; ++j) {
+         int r = cfg->col_inner ? ti+j : ti+i;
+         int c = cfg->col_inner ? tj+i : tj+j;
+         if(cfg->defer_diag && i == j) {
+            tmp = A[r][c];
+            d = j;
+         } else {
+            B[c][r] = A[r][c];
+         }
+      }
+      if(d != -1) {
+         B[tj+d][ti+d] = tmp;
+      }
+   }
+}
+
+/*
+ * trans_tile_find - Looks the tuned configuration for an N x M matrix up
+ *     in tune_table.h
+ */
+const trans_tile_t* trans_tile_find(int M, int N)
+{
+   int i;
+   for(i=0; i<sizeof(tuned_tiles)/sizeof(tuned_tiles[0]); ++i) {
+      if(tuned_tiles[i].M == M && tuned_tiles[i].N == N) {
+         return &tuned_tiles[i];
+      }
+   }
+   return NULL;
+}
+
+/*
+ * transpose_tuned - Transposes with the tuned tiles for this shape, or
+ *     8x8 tiles with diagonal deferral if the shape was never tuned
+ */
+char transpose_tuned_desc[] = "Tuned tiled transpose";
+void transpose_tuned(int M, int N, int A[N][M], int B[M][N])
+{
+   static const trans_tile_t fallback = {0, 0, 8, 8, 0, 0, 1, 0};
+   const trans_tile_t* cfg = trans_tile_find(M, N);
+   trans_tiled(M, N, A, B, cfg ? cfg : &fallback);
+}
+
+/*
+ * transpose_recursive - Cache-oblivious transpose. The longer side of
+ *     the matrix is halved until the pieces are at most BLOCK_SIZE on a
+ *     side. Some level of the recursion fits whatever cache it runs on,
+ *     so no tile size is tuned and no shape is treated specially. Whole
+ *     8x8 pieces go through sub_trans8, whose 4x8 halves keep rows four
+ *     apart from evicting each other as they do at 64x64; the partial
+ *     pieces at the edges go through sub_trans. Rows of 128 ints or more
+ *     still alias within a piece on the lab's 1KB direct mapped cache,
+ *     which no piece size can avoid.
+ */
+char transpose_recursive_desc[] = "Cache-oblivious recursive transpose";
+void transpose_recursive(int M, int N, int A[N][M], int B[M][N])
+{
+   sub_recursive(0, 0, N, M, M, N, A, B);
+}
+
+/*
+ * sub_recursive - Transposes the n x m block of A at row i and column j,
+ *     splitting it in half along its longer side until sub_trans8 or
+ *     sub_trans can take it
+ */
+void sub_recursive(int i, int j, int n, int m, int M, int N, int A[N][M],
+                   int B[M][N])
+{
+   if(n == BLOCK_SIZE && m == BLOCK_SIZE) {
+      sub_trans8(i, j, M, N, A, B);
+   } else if(n <= BLOCK_SIZE && m <= BLOCK_SIZE) {
+      sub_trans(m, n, M, N, &A[i][j], &B[j][i]);
+   } else if(n >= m) {
+      sub_recursive(i, j, n/2, m, M, N, A, B);
+      sub_recursive(i+n/2, j, n-n/2, m, M, N, A, B);
+   } else {
+      sub_recursive(i, j, n, m/2, M, N, A, B);
+      sub_recursive(i, j+m/2, n, m-m/2, M, N, A, B);
+   }
+}
+
+/*
+ * transpose_elems - transpose_recursive for any element type: A is an
+ *     N x M matrix of elements of size bytes and B receives its M x N
+ *     transpose
+ */
+void transpose_elems(int M, int N, size_t size, const void* A, void* B)
+{
+   sub_recursive_elems(0, 0, N, M, M, N, size, A, B);
+}
+
+/* Transposes an n x m block of elements of type T in place of memcpy */
+#define SUB_ELEMS(T) \
+   for(r=i; r<i+n; ++r) \
+      for(c=j; c<j+m; ++c) \
+         ((T*)B)[(size_t)c*N+r] = ((const T*)A)[(size_t)r*M+c]
+
+/*
+ * sub_recursive_elems - sub_recursive for elements of size bytes, with
+ *     the common sizes copied as integers
+ */
+void sub_recursive_elems(int i, int j, int n, int m, int M, int N,
+                         size_t size, const char* A, char* B)
+{
+   int r, c;
+
+   if(n > BLOCK_SIZE || m > BLOCK_SIZE) {
+      if(n >= m) {
+         sub_recursive_elems(i, j, n/2, m, M, N, size, A, B);
+         sub_recursive_elems(i+n/2, j, n-n/2, m, M, N, size, A, B);
+      } else {
+         sub_recursive_elems(i, j, n, m/2, M, N, size, A, B);
+         sub_recursive_elems(i, j+m/2, n, m-m/2, M, N, size, A, B);
+      }
+      return;
+   }
+
+   switch(size) {
+      case 1: SUB_ELEMS(char); break;
+      case 2: SUB_ELEMS(short); break;
+      case 4: SUB_ELEMS(int); break;
+      case 8: SUB_ELEMS(long long); break;
+      default:
+      for(r=i; r<i+n; ++r) {
+         for(c=j; c<j+m; ++c) {
+            memcpy(B + ((size_t)c*N+r)*size, A + ((size_t)r*M+c)*size, size);
+         }
+      }
+   }
+}
+
 /*
  * registerFunctions - This function registers your transpose
  *     functions with the driver.  At runtime, the driver will
@@ -187,6 +351,9 @@ void registerFunctions()
 
     /* Register any additional transpose functions */
     registerTransFunction(trans, trans_desc);
+    registerTransFunction(transpose_tuned, transpose_tuned_desc);
+    registerTransFunction(transpose_recursive, transpose_recursive_desc);
+    trans_simd_register();
 }
 
 /*
@@ -0,0 +1,282 @@
+/*
+ * trans_par.c - Multi-threaded tiled transpose (see trans_par.h)
+ */
+#define _GNU_SOURCE /* for CPU_SET() and pthread_setaffinity_np() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "trans_par.h"
+
+#define CACHE_LINE 64
+
+/* Defined in trans.c */
+void sub_trans(int m, int n, int M, int N, int* A, int* B);
+void sub_trans8(int i, int j, int M, int N, int A[N][M], int B[M][N]);
+
+/*
+ * Tiles [next, end) a worker has yet to take. Thieves shorten end, so it
+ * is locked; each range sits on its own host cache line.
+ */
+typedef struct par_range {
+   pthread_mutex_t lock;
+   long next;
+   long end;
+} __attribute__((aligned(CACHE_LINE))) par_range_t;
+
+/* One call of trans_par() or trans_par_first_touch() */
+typedef struct par_job {
+   int M;
+   int N;
+   int* A;
+   int* B;
+   int down;              /* tiles down a column of A */
+   long tiles;
+   int touch;             /* zero B instead of transposing */
+   int nthreads;
+   par_range_t* ranges;
+   cpu_set_t cpus;        /* the CPUs the caller may run on */
+} par_job_t;
+
+typedef struct par_worker {
+   pthread_t thread;
+   par_job_t* job;
+   int id;
+} par_worker_t;
+
+/* Runs job on nthreads workers, splitting its tiles evenly among them */
+static int run_job(par_job_t* job, int nthreads);
+
+/* Worker thread body: takes and steals tiles until none are left */
+static void* worker_main(void* arg);
+
+/* Takes the next tile of worker id's range. Returns -1 if it is empty */
+static long take(par_job_t* job, int id);
+
+/*
+ * steal - Moves the back half of the longest range left into worker id's
+ * empty range and takes its first tile. Returns -1 if every range is empty.
+ */
+static long steal(par_job_t* job, int id);
+
+/* Transposes, or zeroes the part of B of, tile t */
+static void do_tile(par_job_t* job, long t);
+
+/* Pins the calling thread to the k-th CPU of job->cpus */
+static void pin(const par_job_t* job, int k);
+
+
+
+int trans_par(int M, int N, int A[N][M], int B[M][N], int nthreads) {
+   par_job_t job;
+
+   memset(&job, 0, sizeof(job));
+   job.M = M;
+   job.N = N;
+   job.A = &A[0][0];
+   job.B = &B[0][0];
+   return run_job(&job, nthreads);
+}
+
+
+
+int trans_par_first_touch(int M, int N, int B[M][N], int nthreads) {
+   par_job_t job;
+
+   memset(&job, 0, sizeof(job));
+   job.M = M;
+   job.N = N;
+   job.B = &B[0][0];
+   job.touch = 1;
+   return run_job(&job, nthreads);
+}
+
+
+
+static int run_job(par_job_t* job, int nthreads) {
+   par_worker_t workers[TRANS_PAR_MAX_THREADS];
+   int i, started, ret = 0;
+
+   job->down = (job->N + TRANS_PAR_TILE - 1) / TRANS_PAR_TILE;
+   job->tiles = (long)job->down *
+                ((job->M + TRANS_PAR_TILE - 1) / TRANS_PAR_TILE);
+   if(nthreads < 1 || nthreads > TRANS_PAR_MAX_THREADS) {
+      fprintf(stderr, "The number of threads must be 1 to %d\n",
+              TRANS_PAR_MAX_THREADS);
+      return -1;
+   }
+   if(!job->tiles) {
+      return 0;
+   }
+   if(nthreads > job->tiles) {
+      nthreads = job->tiles;
+   }
+   if(sched_getaffinity(0, sizeof(job->cpus), &job->cpus)) {
+      CPU_ZERO(&job->cpus);
+   }
+   job->nthreads = nthreads;
+   if(posix_memalign((void**)&job->ranges, CACHE_LINE,
+                     nthreads * sizeof(par_range_t))) {
+      fprintf(stderr, "Failed to allocate memory");
+      return -1;
+   }
+   for(i=0; i<nthreads; ++i) {
+      pthread_mutex_init(&job->ranges[i].lock, NULL);
+      job->ranges[i].next = job->tiles * i / nthreads;
+      job->ranges[i].end = job->tiles * (i + 1) / nthreads;
+   }
+
+   // the calling thread is worker 0
+   for(started=1; started<nthreads; ++started) {
+      par_worker_t* w = &workers[started];
+      w->job = job;
+      w->id = started;
+      if(pthread_create(&w->thread, NULL, worker_main, w)) {
+         fprintf(stderr, "Unable to start worker threads\n");
+         ret = -1;
+         break;
+      }
+   }
+   workers[0].job = job;
+   workers[0].id = 0;
+   worker_main(&workers[0]);
+
+   for(i=1; i<started; ++i) {
+      pthread_join(workers[i].thread, NULL);
+   }
+   if(CPU_COUNT(&job->cpus)) {
+      pthread_setaffinity_np(pthread_self(), sizeof(job->cpus), &job->cpus);
+   }
+   for(i=0; i<nthreads; ++i) {
+      pthread_mutex_destroy(&job->ranges[i].lock);
+   }
+   free(job->ranges);
+   return ret;
+}
+
+
+
+static void* worker_main(void* arg) {
+   par_worker_t* w = (par_worker_t*)arg;
+   par_job_t* job = w->job;
+   long t;
+
+   pin(job, w->id);
+   if(job->touch) { // only its own range, so no stealing
+      while((t = take(job, w->id)) >= 0) {
+         do_tile(job, t);
+      }
+      return NULL;
+   }
+   while((t = take(job, w->id)) >= 0 || (t = steal(job, w->id)) >= 0) {
+      do_tile(job, t);
+   }
+   return NULL;
+}
+
+
+
+static long take(par_job_t* job, int id) {
+   par_range_t* r = &job->ranges[id];
+   long t = -1;
+
+   pthread_mutex_lock(&r->lock);
+   if(r->next < r->end) {
+      t = r->next++;
+   }
+   pthread_mutex_unlock(&r->lock);
+   return t;
+}
+
+
+
+static long steal(par_job_t* job, int id) {
+   par_range_t* own = &job->ranges[id];
+   long first, end;
+
+   for(;;) {
+      par_range_t* victim = NULL;
+      long most = 0;
+      int i;
+
+      for(i=0; i<job->nthreads; ++i) {
+         long left;
+         pthread_mutex_lock(&job->ranges[i].lock);
+         left = job->ranges[i].end - job->ranges[i].next;
+         pthread_mutex_unlock(&job->ranges[i].lock);
+         if(i != id && left > most) {
+            most = left;
+            victim = &job->ranges[i];
+         }
+      }
+      if(!victim) {
+         return -1;
+      }
+
+      pthread_mutex_lock(&victim->lock);
+      end = victim->end;
+      first = end - (end - victim->next + 1) / 2;
+      victim->end = first;
+      pthread_mutex_unlock(&victim->lock);
+      if(first < end) {
+         break;
+      }
+   }
+
+   pthread_mutex_lock(&own->lock);
+   own->next = first + 1;
+   own->end = end;
+   pthread_mutex_unlock(&own->lock);
+   return first;
+}
+
+
+
+static void do_tile(par_job_t* job, long t) {
+   int M = job->M, N = job->N;
+   int ti = (int)(t % job->down) * TRANS_PAR_TILE;
+   int tj = (int)(t / job->down) * TRANS_PAR_TILE;
+   int n = ti + TRANS_PAR_TILE <= N ? TRANS_PAR_TILE : N - ti;
+   int m = tj + TRANS_PAR_TILE <= M ? TRANS_PAR_TILE : M - tj;
+   int (*A)[M] = (int (*)[M])job->A;
+   int (*B)[N] = (int (*)[N])job->B;
+   int i, j;
+
+   if(job->touch) {
+      for(j=tj; j<tj+m; ++j) {
+         memset(&B[j][ti], 0, n * sizeof(int));
+      }
+      return;
+   }
+   for(i=ti; i<ti+n; i+=8) {
+      for(j=tj; j<tj+m; j+=8) {
+         if(i+8 <= ti+n && j+8 <= tj+m) {
+            sub_trans8(i, j, M, N, A, B);
+         } else {
+            sub_trans(j+8 <= tj+m ? 8 : tj+m-j, i+8 <= ti+n ? 8 : ti+n-i,
+                      M, N, &A[i][j], &B[j][i]);
+         }
+      }
+   }
+}
+
+
+
+static void pin(const par_job_t* job, int k) {
+   cpu_set_t one;
+   int cpu, seen = 0;
+
+   if(!CPU_COUNT(&job->cpus)) {
+      return;
+   }
+   k %= CPU_COUNT(&job->cpus);
+   for(cpu=0; cpu<CPU_SETSIZE; ++cpu) {
+      if(CPU_ISSET(cpu, &job->cpus) && seen++ == k) {
+         CPU_ZERO(&one);
+         CPU_SET(cpu, &one);
+         pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+         return;
+      }
+   }
+}
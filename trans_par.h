@@ -0,0 +1,47 @@
+/*
+ * trans_par.h - Multi-threaded tiled transpose for native runs.
+ *
+ * trans_par() splits the matrix into tiles of TRANS_PAR_TILE x
+ * TRANS_PAR_TILE elements, numbered down the columns of A so that
+ * consecutive tiles write consecutive rows of B. A tile is transposed in
+ * 8x8 blocks by sub_trans8(), with sub_trans() taking the partial blocks
+ * along the right and bottom edges.
+ *
+ * Each worker thread starts with an equal contiguous range of tiles and
+ * takes tiles from its front. A worker whose range is empty steals the
+ * back half of the longest range left, so a slow core or a busy one does
+ * not hold the others up at the end.
+ *
+ * Worker k is pinned to the k-th CPU the process may run on, in every
+ * call. trans_par_first_touch() zeroes B with the same workers and the
+ * same initial ranges, so on a NUMA machine each page of a freshly
+ * allocated B is placed on the node of the worker that will write it
+ * (unless its tile is stolen).
+ *
+ * The workers' accesses are not seen by test-trans, whose captures are per
+ * thread (see capture.h), so trans_par() is not registered as a transpose
+ * function. transbench -P measures it.
+ */
+#ifndef CSIM_TRANS_PAR_H
+#define CSIM_TRANS_PAR_H
+
+/* Side of the square tiles handed to the workers */
+#define TRANS_PAR_TILE 64
+
+#define TRANS_PAR_MAX_THREADS 256
+
+/*
+ * trans_par - Transposes the N x M matrix A into B on nthreads threads.
+ * Returns 0 on success, and -1 with a message on stderr if the threads
+ * could not be started.
+ */
+int trans_par(int M, int N, int A[N][M], int B[M][N], int nthreads);
+
+/*
+ * trans_par_first_touch - Zeroes B, each part by the worker trans_par()
+ * with the same shape and nthreads will first give it to. Returns 0 on
+ * success, and -1 with a message on stderr.
+ */
+int trans_par_first_touch(int M, int N, int B[M][N], int nthreads);
+
+#endif /* CSIM_TRANS_PAR_H */
@@ -0,0 +1,218 @@
+/*
+ * trans_simd.c - SSE2, AVX2 and AVX-512 transpose kernels (see
+ * trans_simd.h)
+ */
+#include <immintrin.h>
+#include "cachelab.h"
+#include "trans_simd.h"
+
+/* Transposes the n x m block at a into b one element at a time */
+static void block_scalar(int n, int m, const int* a, int lda, int* b,
+                         int ldb);
+
+
+
+static void block4_sse2(const int* a, int lda, int* b, int ldb) {
+   __m128i r0 = _mm_loadu_si128((const __m128i*)a);
+   __m128i r1 = _mm_loadu_si128((const __m128i*)(a + lda));
+   __m128i r2 = _mm_loadu_si128((const __m128i*)(a + 2*lda));
+   __m128i r3 = _mm_loadu_si128((const __m128i*)(a + 3*lda));
+
+   // pairs of rows interleaved: a0 b0 a1 b1, then pairs of pairs
+   __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+   __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+   __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+   __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+   _mm_storeu_si128((__m128i*)b, _mm_unpacklo_epi64(t0, t1));
+   _mm_storeu_si128((__m128i*)(b + ldb), _mm_unpackhi_epi64(t0, t1));
+   _mm_storeu_si128((__m128i*)(b + 2*ldb), _mm_unpacklo_epi64(t2, t3));
+   _mm_storeu_si128((__m128i*)(b + 3*ldb), _mm_unpackhi_epi64(t2, t3));
+}
+
+
+
+__attribute__((target("avx2")))
+static void block8_avx2(const int* a, int lda, int* b, int ldb) {
+   __m256i r[8], t[8], u[8];
+   int i;
+
+   for(i=0; i<8; ++i) {
+      r[i] = _mm256_loadu_si256((const __m256i*)(a + i*lda));
+   }
+   // 4x4 transposes inside each 128-bit lane
+   for(i=0; i<8; i+=2) {
+      t[i] = _mm256_unpacklo_epi32(r[i], r[i+1]);
+      t[i+1] = _mm256_unpackhi_epi32(r[i], r[i+1]);
+   }
+   for(i=0; i<8; i+=4) {
+      u[i] = _mm256_unpacklo_epi64(t[i], t[i+2]);
+      u[i+1] = _mm256_unpackhi_epi64(t[i], t[i+2]);
+      u[i+2] = _mm256_unpacklo_epi64(t[i+1], t[i+3]);
+      u[i+3] = _mm256_unpackhi_epi64(t[i+1], t[i+3]);
+   }
+   // low lanes hold columns 0-3, high lanes columns 4-7
+   for(i=0; i<4; ++i) {
+      _mm256_storeu_si256((__m256i*)(b + i*ldb),
+                          _mm256_permute2x128_si256(u[i], u[i+4], 0x20));
+      _mm256_storeu_si256((__m256i*)(b + (i+4)*ldb),
+                          _mm256_permute2x128_si256(u[i], u[i+4], 0x31));
+   }
+}
+
+
+
+__attribute__((target("avx512f")))
+static void block16_avx512(const int* a, int lda, int* b, int ldb) {
+   __m512i r[16], t[16], u[16];
+   int i;
+
+   for(i=0; i<16; ++i) {
+      r[i] = _mm512_loadu_si512((const void*)(a + i*lda));
+   }
+   // 4x4 transposes inside each 128-bit lane, as for 8x8
+   for(i=0; i<16; i+=2) {
+      t[i] = _mm512_unpacklo_epi32(r[i], r[i+1]);
+      t[i+1] = _mm512_unpackhi_epi32(r[i], r[i+1]);
+   }
+   for(i=0; i<16; i+=4) {
+      u[i] = _mm512_unpacklo_epi64(t[i], t[i+2]);
+      u[i+1] = _mm512_unpackhi_epi64(t[i], t[i+2]);
+      u[i+2] = _mm512_unpacklo_epi64(t[i+1], t[i+3]);
+      u[i+3] = _mm512_unpackhi_epi64(t[i+1], t[i+3]);
+   }
+   /*
+    * Lane l of u[4g+c] now holds column 4l+c of rows 4g..4g+3. Two rounds
+    * of lane shuffles gather lane l of u[c], u[4+c], u[8+c] and u[12+c]
+    */
+   for(i=0; i<4; ++i) {
+      __m512i even01 = _mm512_shuffle_i32x4(u[i], u[i+4], 0x88);
+      __m512i odd01 = _mm512_shuffle_i32x4(u[i], u[i+4], 0xdd);
+      __m512i even23 = _mm512_shuffle_i32x4(u[i+8], u[i+12], 0x88);
+      __m512i odd23 = _mm512_shuffle_i32x4(u[i+8], u[i+12], 0xdd);
+      _mm512_storeu_si512((void*)(b + i*ldb),
+                          _mm512_shuffle_i32x4(even01, even23, 0x88));
+      _mm512_storeu_si512((void*)(b + (i+4)*ldb),
+                          _mm512_shuffle_i32x4(odd01, odd23, 0x88));
+      _mm512_storeu_si512((void*)(b + (i+8)*ldb),
+                          _mm512_shuffle_i32x4(even01, even23, 0xdd));
+      _mm512_storeu_si512((void*)(b + (i+12)*ldb),
+                          _mm512_shuffle_i32x4(odd01, odd23, 0xdd));
+   }
+}
+
+
+
+static int always_supported(void) {
+   return 1;
+}
+
+static int avx2_supported(void) {
+   return __builtin_cpu_supports("avx2");
+}
+
+static int avx512_supported(void) {
+   return __builtin_cpu_supports("avx512f");
+}
+
+const trans_simd_kernel_t trans_simd_kernels[] = {
+   {"sse2", 4, block4_sse2, always_supported},
+   {"avx2", 8, block8_avx2, avx2_supported},
+   {"avx512", 16, block16_avx512, avx512_supported},
+   {NULL, 0, NULL, NULL}
+};
+
+
+
+const trans_simd_kernel_t* trans_simd_best(void) {
+   const trans_simd_kernel_t* k;
+   const trans_simd_kernel_t* best = trans_simd_kernels;
+
+   __builtin_cpu_init();
+   for(k=trans_simd_kernels; k->name; ++k) {
+      if(k->supported()) {
+         best = k;
+      }
+   }
+   return best;
+}
+
+
+
+void trans_simd(int M, int N, int A[N][M], int B[M][N],
+                const trans_simd_kernel_t* k) {
+   int w = k->width;
+   int full_rows = N - N % w;
+   int full_cols = M - M % w;
+   int ti, tj, i, j;
+
+   for(ti=0; ti<full_rows; ti+=TRANS_SIMD_TILE) {
+      for(tj=0; tj<full_cols; tj+=TRANS_SIMD_TILE) {
+         int rows = ti + TRANS_SIMD_TILE < full_rows ? TRANS_SIMD_TILE
+                                                      : full_rows - ti;
+         int cols = tj + TRANS_SIMD_TILE < full_cols ? TRANS_SIMD_TILE
+                                                      : full_cols - tj;
+         for(i=ti; i<ti+rows; i+=w) {
+            for(j=tj; j<tj+cols; j+=w) {
+               k->fn(&A[i][j], M, &B[j][i], N);
+            }
+         }
+      }
+   }
+
+   // the columns right of the last block, then the rows below
+   block_scalar(full_rows, M - full_cols, &A[0][full_cols], M,
+                &B[full_cols][0], N);
+   block_scalar(N - full_rows, M, &A[full_rows][0], M, &B[0][full_rows], N);
+}
+
+
+
+/*
+ * The registered transposes: the widest supported kernel, then each
+ * kernel by name
+ */
+char transpose_simd_desc[] = "SIMD register-blocked transpose";
+static void transpose_simd(int M, int N, int A[N][M], int B[M][N]) {
+   trans_simd(M, N, A, B, trans_simd_best());
+}
+
+#define TRANS_SIMD_FUNC(i, desc) \
+   static void transpose_simd##i(int M, int N, int A[N][M], int B[M][N]) { \
+      trans_simd(M, N, A, B, &trans_simd_kernels[i]); \
+   } \
+   static char transpose_simd##i##_desc[] = desc;
+
+TRANS_SIMD_FUNC(0, "SIMD 4x4 transpose (sse2)")
+TRANS_SIMD_FUNC(1, "SIMD 8x8 transpose (avx2)")
+TRANS_SIMD_FUNC(2, "SIMD 16x16 transpose (avx512)")
+
+void trans_simd_register(void) {
+   void (*funcs[])(int M, int N, int[N][M], int[M][N]) = {
+      transpose_simd0, transpose_simd1, transpose_simd2
+   };
+   char* descs[] = {
+      transpose_simd0_desc, transpose_simd1_desc, transpose_simd2_desc
+   };
+   int i;
+
+   registerTransFunction(transpose_simd, transpose_simd_desc);
+   __builtin_cpu_init();
+   for(i=0; trans_simd_kernels[i].name; ++i) {
+      if(trans_simd_kernels[i].supported()) {
+         registerTransFunction(funcs[i], descs[i]);
+      }
+   }
+}
+
+
+
+static void block_scalar(int n, int m, const int* a, int lda, int* b,
+                         int ldb) {
+   int i, j;
+   for(i=0; i<n; ++i) {
+      for(j=0; j<m; ++j) {
+         b[j*ldb + i] = a[i*lda + j];
+      }
+   }
+}
@@ -0,0 +1,50 @@
+/*
+ * trans_simd.h - Register-blocked transpose kernels for native runs.
+ *
+ * A kernel transposes one square block of 4x4 (SSE2), 8x8 (AVX2) or 16x16
+ * (AVX-512) ints entirely in vector registers: each row of the block is
+ * loaded once, the rows are interleaved with unpack and lane shuffles
+ * until each register holds a column, and each column is stored once as
+ * a row of B. trans_simd() walks the matrix in tiles of TRANS_SIMD_TILE
+ * elements made of kernel blocks, and handles the rows and columns that
+ * do not fill a block with scalar code.
+ *
+ * The vector kernels are compiled with per-function target attributes, as
+ * in lookup.c, so the file builds with the default flags and the kernel
+ * is picked at runtime from the host's cpuid. trans_simd_register()
+ * registers a transpose function per kernel the host supports.
+ */
+#ifndef CSIM_TRANS_SIMD_H
+#define CSIM_TRANS_SIMD_H
+
+/* Side of the square tiles of kernel blocks trans_simd() walks through */
+#define TRANS_SIMD_TILE 64
+
+/* Transposes the width x width block at a (row stride lda) into b */
+typedef void (*trans_block_fn)(const int* a, int lda, int* b, int ldb);
+
+/* A kernel and the name used to select it */
+typedef struct trans_simd_kernel {
+   const char* name;
+   int width;                 /* side of the block, 4, 8 or 16 */
+   trans_block_fn fn;
+   int (*supported)(void);
+} trans_simd_kernel_t;
+
+/* All kernels, narrowest first, terminated by a NULL name */
+extern const trans_simd_kernel_t trans_simd_kernels[];
+
+/* Returns the widest kernel the host supports */
+const trans_simd_kernel_t* trans_simd_best(void);
+
+/* Transposes the N x M matrix A into B with kernel k */
+void trans_simd(int M, int N, int A[N][M], int B[M][N],
+                const trans_simd_kernel_t* k);
+
+/*
+ * trans_simd_register - Registers the transpose of the widest kernel, and
+ * one per supported kernel, with registerTransFunction()
+ */
+void trans_simd_register(void);
+
+#endif /* CSIM_TRANS_SIMD_H */
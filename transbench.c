@@ -0,0 +1,219 @@
+/*
+ * transbench.c - Native throughput of the registered transpose functions
+ *
+ * Runs every function registered by trans.c (compiled with -O2 here) on
+ * an M x N matrix, checks the result with is_transpose() and prints the
+ * best time of several runs and the bandwidth it implies: each run reads
+ * A and writes B once, 2*M*N*sizeof(int) bytes. Simulated misses say how
+ * a function treats the lab's tiny cache; this says how fast it is on the
+ * host. -e times transpose_elems() on elements of that many bytes
+ * instead, and -P times trans_par() (see trans_par.h) on 1 to <threads>
+ * threads, with B first touched by the same threads each time.
+ *
+ *     linux> ./transbench [-M <cols>] [-N <rows>] [-r <runs>] [-F <func>]
+ *                         [-e <bytes>] [-P <threads>]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "cachelab.h"
+#include "trans_par.h"
+
+/* Defined in cachelab.c and trans.c */
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+extern void registerFunctions();
+extern int is_transpose(int M, int N, int A[N][M], int B[M][N]);
+extern void transpose_elems(int M, int N, size_t size, const void* A,
+                            void* B);
+
+static double now(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Times trans_par() on 1 to max_threads threads */
+static void bench_par(int M, int N, int max_threads, int runs) {
+   size_t elems = (size_t)M * N;
+   int* A = (int*)malloc(elems * sizeof(int));
+   double base = 0;
+   size_t i;
+   int n, r;
+
+   if(!A) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+   for(i=0; i<elems; ++i) {
+      A[i] = rand();
+   }
+   printf("%dx%d ints, trans_par, best of %d runs\n", N, M, runs);
+   for(n=1; n<=max_threads; ++n) {
+      // a fresh B each time, so its pages follow this thread count
+      int* B = (int*)malloc(elems * sizeof(int));
+      double best = 0;
+      int ok;
+      if(!B || trans_par_first_touch(M, N, (int (*)[N])B, n)) {
+         fprintf(stderr, "Failed to allocate memory");
+         exit(1);
+      }
+      for(r=0; r<runs; ++r) {
+         double start = now(), t;
+         if(trans_par(M, N, (int (*)[M])A, (int (*)[N])B, n)) {
+            exit(1);
+         }
+         t = now() - start;
+         if(!r || t < best) {
+            best = t;
+         }
+      }
+      if(n == 1) {
+         base = best;
+      }
+      ok = is_transpose(M, N, (int (*)[M])A, (int (*)[N])B);
+      printf("threads %d: %.3f ms, %.2f GB/s, %.2fx%s\n", n, best * 1e3,
+             2.0 * elems * sizeof(int) / best / 1e9, base / best,
+             ok ? "" : ", INCORRECT");
+      free(B);
+   }
+   free(A);
+}
+
+/* Times transpose_elems() on an N x M matrix of size byte elements */
+static void bench_elems(int M, int N, size_t size, int runs) {
+   size_t bytes = (size_t)M * N * size;
+   char* A = (char*)malloc(bytes);
+   char* B = (char*)calloc(bytes, 1);
+   double best = 0;
+   size_t i;
+   int r, c, ok = 1;
+
+   if(!A || !B) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+   for(i=0; i<bytes; ++i) {
+      A[i] = (char)rand();
+   }
+   for(r=0; r<runs; ++r) {
+      double start = now(), t;
+      transpose_elems(M, N, size, A, B);
+      t = now() - start;
+      if(!r || t < best) {
+         best = t;
+      }
+   }
+   for(r=0; r<N && ok; ++r) {
+      for(c=0; c<M && ok; ++c) {
+         ok = !memcmp(B + ((size_t)c*N+r)*size, A + ((size_t)r*M+c)*size, size);
+      }
+   }
+   printf("%dx%d %zu-byte elements, best of %d runs\n", N, M, size, runs);
+   printf("transpose_elems: %.3f ms, %.2f GB/s%s\n", best * 1e3,
+          2.0 * bytes / best / 1e9, ok ? "" : ", INCORRECT");
+   free(A);
+   free(B);
+}
+
+int main(int argc, char* argv[])
+{
+   int M = 2048, N = 2048;
+   int runs = 5;
+   int only = -1;
+   int elem_size = 0;
+   int max_threads = 0;
+   int opt, f, r;
+   int* A;
+   int* B;
+   size_t i, elems;
+
+   while((opt = getopt(argc, argv, "M:N:r:F:e:P:")) != -1) {
+      switch(opt) {
+         case 'M':
+         M = atoi(optarg);
+         break;
+
+         case 'N':
+         N = atoi(optarg);
+         break;
+
+         case 'r':
+         runs = atoi(optarg);
+         break;
+
+         case 'F':
+         only = atoi(optarg);
+         break;
+
+         case 'e':
+         elem_size = atoi(optarg);
+         break;
+
+         case 'P':
+         max_threads = atoi(optarg);
+         break;
+
+         default:
+         fprintf(stderr, "Usage: %s [-M <cols>] [-N <rows>] [-r <runs>] "
+                 "[-F <func>] [-e <bytes>] [-P <threads>]\n", argv[0]);
+         exit(1);
+      }
+   }
+   if(M < 1 || N < 1 || runs < 1 || elem_size < 0 || max_threads < 0) {
+      fprintf(stderr, "M, N and the number of runs must be positive\n");
+      exit(1);
+   }
+   if(elem_size) {
+      bench_elems(M, N, elem_size, runs);
+      return 0;
+   }
+   if(max_threads) {
+      bench_par(M, N, max_threads, runs);
+      return 0;
+   }
+
+   elems = (size_t)M * N;
+   A = (int*)malloc(elems * sizeof(int));
+   B = (int*)malloc(elems * sizeof(int));
+   if(!A || !B) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+   for(i=0; i<elems; ++i) {
+      A[i] = rand();
+   }
+   registerFunctions();
+
+   printf("%dx%d ints, best of %d runs\n", N, M, runs);
+   for(f=0; f<func_counter; ++f) {
+      double best = 0;
+      int ok;
+      if(only != -1 && f != only) {
+         continue;
+      }
+
+      // the first run also faults B in
+      memset(B, 0, elems * sizeof(int));
+      for(r=0; r<runs; ++r) {
+         double start = now(), t;
+         (*func_list[f].func_ptr)(M, N, (int (*)[M])A, (int (*)[N])B);
+         t = now() - start;
+         if(!r || t < best) {
+            best = t;
+         }
+      }
+      ok = is_transpose(M, N, (int (*)[M])A, (int (*)[N])B);
+      printf("func %d (%s): %.3f ms, %.2f GB/s%s\n", f,
+             func_list[f].description, best * 1e3,
+             2.0 * elems * sizeof(int) / best / 1e9,
+             ok ? "" : ", INCORRECT");
+   }
+
+   free(A);
+   free(B);
+   return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * tune.c - Searches tiled transpose configurations (see tune.h) for the
+ * fewest misses on a given cache, and prints the winners as tune_table.h.
+ *
+ * Every candidate runs natively on instrumented matrices, its accesses
+ * captured straight into an in-process simulator (see capture.h), so a
+ * candidate costs about as much as simulating its trace:
+ *
+ *     linux> ./tune -s 5 -E 1 -b 5 32x32 64x64 61x67 > tune_table.h
+ *
+ * The search covers every tile shape up to -T x -T (default 32), both
+ * orders of visiting the tiles, both orders of visiting the elements of a
+ * tile, and diagonal deferral on or off, plus 8x8 tiles transposed by
+ * sub_trans8() in either tile order. Ties go to the candidate found
+ * first, so the output is deterministic. The matrices are allocated for
+ * each shape, so any shape can be tuned.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "libcsim.h"
+#include "capture.h"
+#include "tune.h"
+
+/* The matrices of the shape being tuned */
+static int* A;
+static int* B;
+
+/*
+ * score - Returns the misses of one candidate on a 2^s x E x 2^b cache,
+ * or -1 if it does not transpose correctly
+ */
+static long score(const trans_tile_t* cfg, int s, int E, int b)
+{
+   int M = cfg->M;
+   int N = cfg->N;
+   csim_t* sim = csim_create(s, E, b, NULL);
+   csim_stats_t stats;
+   int i, j;
+
+   if(!sim) {
+      exit(1);
+   }
+   initMatrix(M, N, (int (*)[M])A, (int (*)[N])B);
+   capture_start(sim);
+   capture_region(A, (size_t)M * N * sizeof(int), CAPTURE_A_BASE);
+   capture_region(B, (size_t)M * N * sizeof(int),
+                  CAPTURE_B_BASE_FOR((size_t)M * N));
+   trans_tiled(M, N, (int (*)[M])A, (int (*)[N])B, cfg);
+   capture_stop();
+   csim_stats(sim, &stats);
+   csim_destroy(sim);
+
+   for(i=0; i<N; ++i) {
+      for(j=0; j<M; ++j) {
+         if(A[M*i+j] != B[N*j+i]) {
+            return -1;
+         }
+      }
+   }
+   return stats.misses - CAPTURE_FIXED_MISSES;
+}
+
+
+
+/* Finds the best configuration for one shape */
+static trans_tile_t tune(int M, int N, int s, int E, int b, int max_tile,
+                         long* best_misses)
+{
+   trans_tile_t cfg, best;
+   int flags;
+   long misses;
+
+   memset(&best, 0, sizeof(best));
+   memset(&cfg, 0, sizeof(cfg));
+   *best_misses = -1;
+   cfg.M = M;
+   cfg.N = N;
+   A = (int*)malloc((size_t)M * N * sizeof(int));
+   B = (int*)malloc((size_t)M * N * sizeof(int));
+   if(!A || !B) {
+      fprintf(stderr, "Failed to allocate memory");
+      exit(1);
+   }
+   for(cfg.tile_rows=1; cfg.tile_rows<=max_tile && cfg.tile_rows<=N;
+       ++cfg.tile_rows) {
+      for(cfg.tile_cols=1; cfg.tile_cols<=max_tile && cfg.tile_cols<=M;
+          ++cfg.tile_cols) {
+         // the sub_trans8() candidates only vary the tile order
+         for(flags=0; flags<(cfg.tile_rows == 8 && cfg.tile_cols == 8 ?
+                             10 : 8); ++flags) {
+            cfg.col_major = flags & 1;
+            cfg.col_inner = flags < 8 && (flags >> 1) & 1;
+            cfg.defer_diag = flags < 8 && (flags >> 2) & 1;
+            cfg.trans8 = flags >= 8;
+            misses = score(&cfg, s, E, b);
+            if(misses == -1) {
+               fprintf(stderr, "%dx%d tile %dx%d does not transpose\n", M,
+                       N, cfg.tile_rows, cfg.tile_cols);
+               exit(1);
+            }
+            if(*best_misses == -1 || misses < *best_misses) {
+               best = cfg;
+               *best_misses = misses;
+            }
+         }
+      }
+   }
+   free(A);
+   free(B);
+   return best;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+   int s = 5, E = 1, b = 5;
+   int max_tile = 32;
+   int opt, i;
+
+   while((opt = getopt(argc, argv, "s:E:b:T:")) != -1) {
+      switch(opt) {
+         case 's':
+         s = atoi(optarg);
+         break;
+
+         case 'E':
+         E = atoi(optarg);
+         break;
+
+         case 'b':
+         b = atoi(optarg);
+         break;
+
+         case 'T':
+         max_tile = atoi(optarg);
+         break;
+
+         default:
+         fprintf(stderr, "Usage: %s [-s <s>] [-E <E>] [-b <b>] [-T <max tile>] "
+                 "<M>x<N> ...\n", argv[0]);
+         exit(1);
+      }
+   }
+   if(optind == argc || max_tile < 1) {
+      fprintf(stderr, "Usage: %s [-s <s>] [-E <E>] [-b <b>] [-T <max tile>] "
+              "<M>x<N> ...\n", argv[0]);
+      exit(1);
+   }
+
+   printf("/*\n"
+          " * tune_table.h - Tuned tile configurations, see tune.h. Generated by\n"
+          " * ./tune -s %d -E %d -b %d -T %d", s, E, b, max_tile);
+   for(i=optind; i<argc; ++i) {
+      printf(" %s", argv[i]);
+   }
+   printf(",\n * regenerate with make tune-table.\n */\n"
+          "static const trans_tile_t tuned_tiles[] = {\n"
+          "   /* M, N, rows, cols, col_major, col_inner, defer_diag, "
+          "trans8 */\n");
+
+   for(i=optind; i<argc; ++i) {
+      int M, N;
+      long misses;
+      trans_tile_t best;
+      if(sscanf(argv[i], "%dx%d", &M, &N) != 2 || M < 1 || N < 1) {
+         fprintf(stderr, "Invalid shape %s, expected <M>x<N>\n", argv[i]);
+         exit(1);
+      }
+      best = tune(M, N, s, E, b, max_tile, &misses);
+      printf("   {%d, %d, %d, %d, %d, %d, %d, %d},  /* %ld misses */\n",
+             best.M, best.N, best.tile_rows, best.tile_cols, best.col_major,
+             best.col_inner, best.defer_diag, best.trans8, misses);
+   }
+   printf("   {0, 0, 0, 0, 0, 0, 0, 0}\n};\n");
+   return 0;
+}
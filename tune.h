@@ -0,0 +1,33 @@
+/*
+ * tune.h - Tiled transpose kernels selected by the tuner.
+ *
+ * trans_tiled() transposes a matrix tile by tile, with the tile shape,
+ * the order the tiles and the elements inside them are visited in, and
+ * the diagonal deferral of sub_trans() all given by a trans_tile_t, which
+ * can also hand whole 8x8 tiles to the 4x8 halves of sub_trans8().
+ * tune.c searches these parameters for the fewest misses on a given cache
+ * and writes the winners to tune_table.h, which trans_tile_find() looks
+ * matrix shapes up in.
+ */
+#ifndef CSIM_TUNE_H
+#define CSIM_TUNE_H
+
+typedef struct trans_tile {
+   int M;            /* matrix shape the entry was tuned for */
+   int N;
+   int tile_rows;    /* rows of A per tile */
+   int tile_cols;    /* columns of A per tile */
+   int col_major;    /* visit the tiles down the columns of A */
+   int col_inner;    /* visit a tile's elements column by column */
+   int defer_diag;   /* store each row's (column's) diagonal element last */
+   int trans8;       /* whole 8x8 tiles go through sub_trans8() instead */
+} trans_tile_t;
+
+/* Transposes the N x M matrix A into B as described by cfg */
+void trans_tiled(int M, int N, int A[N][M], int B[M][N],
+                 const trans_tile_t* cfg);
+
+/* Returns the tuned configuration for an N x M matrix, or NULL */
+const trans_tile_t* trans_tile_find(int M, int N);
+
+#endif /* CSIM_TUNE_H */
@@ -0,0 +1,12 @@
+/*
+ * tune_table.h - Tuned tile configurations, see tune.h. Generated by
+ * ./tune -s 5 -E 1 -b 5 -T 32 32x32 64x64 61x67,
+ * regenerate with make tune-table.
+ */
+static const trans_tile_t tuned_tiles[] = {
+   /* M, N, rows, cols, col_major, col_inner, defer_diag, trans8 */
+   {32, 32, 8, 8, 0, 0, 1, 0},  /* 285 misses */
+   {64, 64, 8, 8, 0, 0, 0, 1},  /* 1169 misses */
+   {61, 67, 8, 16, 1, 0, 1, 0},  /* 1789 misses */
+   {0, 0, 0, 0, 0, 0, 0, 0}
+};